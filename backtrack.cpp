@@ -5,6 +5,7 @@
 
 #include "geometry.hpp"
 #include "bg_operators.hpp"
+#include "profile.hpp"
 
 #include "backtrack.hpp"
 
@@ -158,6 +159,7 @@ vector<pair<linestring_type_fp, bool>> backtrack(
     const vector<pair<linestring_type_fp, bool>>& paths,
     const double g1_speed, const double up_time, const double g0_speed, const double down_time,
     const double in_per_sec) {
+  profile::Timer timer("backtrack");
   if (in_per_sec == 0) {
     return {};
   }
@@ -0,0 +1,501 @@
+#include "batch_intersect.hpp"
+
+#include <algorithm>
+#include <limits>
+
+#include "bg_operators.hpp"
+
+// The vector kernels are only built where the compiler can target
+// them per function.  If the whole program may use FMA then the
+// scalar code might be fused and round differently from the vector
+// code, which never is, so then only the scalar code is used.  32-bit
+// x86 might do the scalar math in 80 bits for the same reason.
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__) && !defined(__FMA__)
+#define BATCH_INTERSECT_X86
+#include <immintrin.h>
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace batch_intersect {
+
+using std::vector;
+
+namespace {
+
+// The same as path_finding::is_left.
+inline coordinate_type_fp is_left(point_type_fp p0, point_type_fp p1, point_type_fp p2) {
+  return ((p1.x() - p0.x()) * (p2.y() - p0.y()) -
+          (p2.x() - p0.x()) * (p1.y() - p0.y()));
+}
+
+// The same as path_finding::is_between.
+inline coordinate_type_fp is_between(coordinate_type_fp a,
+                                     coordinate_type_fp x,
+                                     coordinate_type_fp b) {
+  return x == a || x == b || (a-x>0) == (x-b>0);
+}
+
+// The same as path_finding::is_intersecting.
+inline bool is_intersecting(const point_type_fp& p0, const point_type_fp& p1,
+                            const point_type_fp& p2, const point_type_fp& p3) {
+  const coordinate_type_fp left012 = is_left(p0, p1, p2);
+  const coordinate_type_fp left013 = is_left(p0, p1, p3);
+  const coordinate_type_fp left230 = is_left(p2, p3, p0);
+  const coordinate_type_fp left231 = is_left(p2, p3, p1);
+
+  if (p0 != p1) {
+    if (left012 == 0) {
+      if (is_between(p0.x(), p2.x(), p1.x()) &&
+          is_between(p0.y(), p2.y(), p1.y())) {
+        return true; // p2 is on the line p0 to p1
+      }
+    }
+    if (left013 == 0) {
+      if (is_between(p0.x(), p3.x(), p1.x()) &&
+          is_between(p0.y(), p3.y(), p1.y())) {
+        return true; // p3 is on the line p0 to p1
+      }
+    }
+  }
+  if (p2 != p3) {
+    if (left230 == 0) {
+      if (is_between(p2.x(), p0.x(), p3.x()) &&
+          is_between(p2.y(), p0.y(), p3.y())) {
+        return true; // p0 is on the line p2 to p3
+      }
+    }
+    if (left231 == 0) {
+      if (is_between(p2.x(), p1.x(), p3.x()) &&
+          is_between(p2.y(), p1.y(), p3.y())) {
+        return true; // p1 is on the line p2 to p3
+      }
+    }
+  }
+  if ((left012 > 0) == (left013 > 0) ||
+      (left230 > 0) == (left231 > 0)) {
+    if (p1 == p2) {
+      return true;
+    }
+    return false;
+  } else {
+    return true;
+  }
+}
+
+struct Query {
+  Query(const point_type_fp& p0, const point_type_fp& p1) :
+    p0(p0),
+    p1(p1),
+    min_x(std::min(p0.x(), p1.x())),
+    min_y(std::min(p0.y(), p1.y())),
+    max_x(std::max(p0.x(), p1.x())),
+    max_y(std::max(p0.y(), p1.y())) {}
+  const point_type_fp p0;
+  const point_type_fp p1;
+  const coordinate_type_fp min_x;
+  const coordinate_type_fp min_y;
+  const coordinate_type_fp max_x;
+  const coordinate_type_fp max_y;
+};
+
+bool any_intersecting_scalar(const Query& query, const SegmentBlock& block,
+                             size_t begin, size_t end) {
+  for (size_t i = begin; i < end; i++) {
+    if (!(query.min_x > block.min_x_bound[i]) &&
+        !(query.min_y > block.min_y_bound[i]) &&
+        !(query.max_x < block.max_x_bound[i]) &&
+        !(query.max_y < block.max_y_bound[i]) &&
+        is_intersecting(query.p0, query.p1, block.first(i), block.second(i))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// From: http://geomalgorithms.com/a03-_inclusion.html
+int winding_number_scalar(const point_type_fp& point, const ring_type_fp& ring,
+                          size_t begin) {
+  int winding_number = 0;
+  for (size_t i = begin; i + 1 < ring.size(); i++) {
+    if (ring[i].y() <= point.y()) {                   // start y <= point.y
+      if (ring[i+1].y() > point.y()) {                // an upward crossing
+        if (is_left(ring[i], ring[i+1], point) > 0) { // point left of  edge
+          ++winding_number;                           // have a valid up intersect
+        }
+      }
+    } else {                                          // start y > point.y
+      if (ring[i+1].y() <= point.y()) {               // a downward crossing
+        if (is_left(ring[i], ring[i+1], point) < 0) { // P right of  edge
+          --winding_number;                           // have a valid down intersect
+        }
+      }
+    }
+  }
+  return winding_number;
+}
+
+#ifdef BATCH_INTERSECT_X86
+
+// The vector code computes every branch of the scalar code for each
+// lane with the same operations in the same order and then combines
+// the masks, so the results are exactly the same.  Comparisons are
+// ordered, like in C++, and the negated comparisons are unordered so
+// that they match !(a > b) when there are NaNs.
+
+// A ring is a vector of points that are each an x and a y so it can
+// be read as x0, y0, x1, y1, ...
+static_assert(sizeof(point_type_fp) == 2 * sizeof(coordinate_type_fp),
+              "points must be just their coordinates");
+inline const coordinate_type_fp* coordinates(const ring_type_fp& ring) {
+  return reinterpret_cast<const coordinate_type_fp*>(ring.data());
+}
+
+// The number of bits set in a mask from movemask.
+inline int lanes_set(int mask) {
+  return (mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + ((mask >> 3) & 1);
+}
+
+TARGET_SSE2 inline __m128d is_left_sse2(__m128d p0x, __m128d p0y,
+                                        __m128d p1x, __m128d p1y,
+                                        __m128d p2x, __m128d p2y) {
+  return _mm_sub_pd(_mm_mul_pd(_mm_sub_pd(p1x, p0x), _mm_sub_pd(p2y, p0y)),
+                    _mm_mul_pd(_mm_sub_pd(p2x, p0x), _mm_sub_pd(p1y, p0y)));
+}
+
+TARGET_SSE2 inline __m128d ones_sse2() {
+  return _mm_castsi128_pd(_mm_set1_epi32(-1));
+}
+
+// All ones in the lanes where a and b are both true or both false.
+TARGET_SSE2 inline __m128d same_sse2(__m128d a, __m128d b) {
+  return _mm_andnot_pd(_mm_xor_pd(a, b), ones_sse2());
+}
+
+TARGET_SSE2 inline __m128d is_between_sse2(__m128d a, __m128d x, __m128d b) {
+  const __m128d zero = _mm_setzero_pd();
+  return _mm_or_pd(_mm_or_pd(_mm_cmpeq_pd(x, a), _mm_cmpeq_pd(x, b)),
+                   same_sse2(_mm_cmpgt_pd(_mm_sub_pd(a, x), zero),
+                             _mm_cmpgt_pd(_mm_sub_pd(x, b), zero)));
+}
+
+// Tests two at a time from begin and leaves begin at the ones that are left.
+TARGET_SSE2 bool any_intersecting_sse2(const Query& query, const SegmentBlock& block,
+                                       size_t& begin, size_t end) {
+  const __m128d zero = _mm_setzero_pd();
+  const __m128d p0x = _mm_set1_pd(query.p0.x());
+  const __m128d p0y = _mm_set1_pd(query.p0.y());
+  const __m128d p1x = _mm_set1_pd(query.p1.x());
+  const __m128d p1y = _mm_set1_pd(query.p1.y());
+  const __m128d min_x = _mm_set1_pd(query.min_x);
+  const __m128d min_y = _mm_set1_pd(query.min_y);
+  const __m128d max_x = _mm_set1_pd(query.max_x);
+  const __m128d max_y = _mm_set1_pd(query.max_y);
+  const __m128d query_distinct = _mm_castsi128_pd(_mm_set1_epi64x(query.p0 != query.p1 ? -1 : 0));
+  for (; begin + 2 <= end; begin += 2) {
+    const __m128d reached =
+        _mm_and_pd(_mm_and_pd(_mm_cmpngt_pd(min_x, _mm_loadu_pd(&block.min_x_bound[begin])),
+                              _mm_cmpngt_pd(min_y, _mm_loadu_pd(&block.min_y_bound[begin]))),
+                   _mm_and_pd(_mm_cmpnlt_pd(max_x, _mm_loadu_pd(&block.max_x_bound[begin])),
+                              _mm_cmpnlt_pd(max_y, _mm_loadu_pd(&block.max_y_bound[begin]))));
+    if (_mm_movemask_pd(reached) == 0) {
+      continue;
+    }
+    const __m128d p2x = _mm_loadu_pd(&block.x0[begin]);
+    const __m128d p2y = _mm_loadu_pd(&block.y0[begin]);
+    const __m128d p3x = _mm_loadu_pd(&block.x1[begin]);
+    const __m128d p3y = _mm_loadu_pd(&block.y1[begin]);
+    const __m128d left012 = is_left_sse2(p0x, p0y, p1x, p1y, p2x, p2y);
+    const __m128d left013 = is_left_sse2(p0x, p0y, p1x, p1y, p3x, p3y);
+    const __m128d left230 = is_left_sse2(p2x, p2y, p3x, p3y, p0x, p0y);
+    const __m128d left231 = is_left_sse2(p2x, p2y, p3x, p3y, p1x, p1y);
+    const __m128d not_crossing = _mm_or_pd(
+        same_sse2(_mm_cmpgt_pd(left012, zero), _mm_cmpgt_pd(left013, zero)),
+        same_sse2(_mm_cmpgt_pd(left230, zero), _mm_cmpgt_pd(left231, zero)));
+    const __m128d touching = _mm_and_pd(_mm_cmpeq_pd(p1x, p2x), _mm_cmpeq_pd(p1y, p2y));
+    __m128d hit = _mm_and_pd(
+        reached, _mm_or_pd(_mm_andnot_pd(not_crossing, ones_sse2()), touching));
+    // The rest only matters if a point is on the line of the other segment.
+    const __m128d on_line = _mm_or_pd(
+        _mm_or_pd(_mm_cmpeq_pd(left012, zero), _mm_cmpeq_pd(left013, zero)),
+        _mm_or_pd(_mm_cmpeq_pd(left230, zero), _mm_cmpeq_pd(left231, zero)));
+    if (_mm_movemask_pd(_mm_and_pd(reached, on_line)) != 0) {
+      const __m128d on_query = _mm_and_pd(
+          query_distinct,
+          _mm_or_pd(_mm_and_pd(_mm_cmpeq_pd(left012, zero),
+                               _mm_and_pd(is_between_sse2(p0x, p2x, p1x),
+                                          is_between_sse2(p0y, p2y, p1y))),
+                    _mm_and_pd(_mm_cmpeq_pd(left013, zero),
+                               _mm_and_pd(is_between_sse2(p0x, p3x, p1x),
+                                          is_between_sse2(p0y, p3y, p1y)))));
+      const __m128d segment_distinct = _mm_andnot_pd(
+          _mm_and_pd(_mm_cmpeq_pd(p2x, p3x), _mm_cmpeq_pd(p2y, p3y)),
+          ones_sse2());
+      const __m128d on_segment = _mm_and_pd(
+          segment_distinct,
+          _mm_or_pd(_mm_and_pd(_mm_cmpeq_pd(left230, zero),
+                               _mm_and_pd(is_between_sse2(p2x, p0x, p3x),
+                                          is_between_sse2(p2y, p0y, p3y))),
+                    _mm_and_pd(_mm_cmpeq_pd(left231, zero),
+                               _mm_and_pd(is_between_sse2(p2x, p1x, p3x),
+                                          is_between_sse2(p2y, p1y, p3y)))));
+      hit = _mm_or_pd(hit, _mm_and_pd(reached, _mm_or_pd(on_query, on_segment)));
+    }
+    if (_mm_movemask_pd(hit) != 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Counts two edges at a time from begin and leaves begin at the ones
+// that are left.
+TARGET_SSE2 int winding_number_sse2(const point_type_fp& point, const ring_type_fp& ring,
+                                    size_t& begin) {
+  const __m128d zero = _mm_setzero_pd();
+  const __m128d px = _mm_set1_pd(point.x());
+  const __m128d py = _mm_set1_pd(point.y());
+  const coordinate_type_fp* xy = coordinates(ring);
+  int winding_number = 0;
+  for (; begin + 3 <= ring.size(); begin += 2) {
+    const __m128d p0 = _mm_loadu_pd(xy + 2*begin);
+    const __m128d p1 = _mm_loadu_pd(xy + 2*begin + 2);
+    const __m128d p2 = _mm_loadu_pd(xy + 2*begin + 4);
+    const __m128d y0 = _mm_unpackhi_pd(p0, p1);
+    const __m128d y1 = _mm_unpackhi_pd(p1, p2);
+    const __m128d start_below = _mm_cmple_pd(y0, py);
+    const __m128d end_below = _mm_cmple_pd(y1, py);
+    // Most edges don't cross the horizontal line through the point.
+    if (_mm_movemask_pd(_mm_xor_pd(start_below, end_below)) == 0) {
+      continue;
+    }
+    const __m128d left = is_left_sse2(_mm_unpacklo_pd(p0, p1), y0,
+                                      _mm_unpacklo_pd(p1, p2), y1, px, py);
+    const __m128d up = _mm_and_pd(start_below,
+                                  _mm_and_pd(_mm_cmpgt_pd(y1, py), _mm_cmpgt_pd(left, zero)));
+    const __m128d down = _mm_andnot_pd(start_below,
+                                       _mm_and_pd(end_below, _mm_cmplt_pd(left, zero)));
+    winding_number += lanes_set(_mm_movemask_pd(up));
+    winding_number -= lanes_set(_mm_movemask_pd(down));
+  }
+  return winding_number;
+}
+
+TARGET_AVX2 inline __m256d is_left_avx2(__m256d p0x, __m256d p0y,
+                                        __m256d p1x, __m256d p1y,
+                                        __m256d p2x, __m256d p2y) {
+  return _mm256_sub_pd(_mm256_mul_pd(_mm256_sub_pd(p1x, p0x), _mm256_sub_pd(p2y, p0y)),
+                       _mm256_mul_pd(_mm256_sub_pd(p2x, p0x), _mm256_sub_pd(p1y, p0y)));
+}
+
+TARGET_AVX2 inline __m256d ones_avx2() {
+  return _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+}
+
+// All ones in the lanes where a and b are both true or both false.
+TARGET_AVX2 inline __m256d same_avx2(__m256d a, __m256d b) {
+  return _mm256_andnot_pd(_mm256_xor_pd(a, b), ones_avx2());
+}
+
+TARGET_AVX2 inline __m256d is_between_avx2(__m256d a, __m256d x, __m256d b) {
+  const __m256d zero = _mm256_setzero_pd();
+  return _mm256_or_pd(_mm256_or_pd(_mm256_cmp_pd(x, a, _CMP_EQ_OQ), _mm256_cmp_pd(x, b, _CMP_EQ_OQ)),
+                      same_avx2(_mm256_cmp_pd(_mm256_sub_pd(a, x), zero, _CMP_GT_OQ),
+                                _mm256_cmp_pd(_mm256_sub_pd(x, b), zero, _CMP_GT_OQ)));
+}
+
+// Tests four at a time from begin and leaves begin at the ones that are left.
+TARGET_AVX2 bool any_intersecting_avx2(const Query& query, const SegmentBlock& block,
+                                       size_t& begin, size_t end) {
+  const __m256d zero = _mm256_setzero_pd();
+  const __m256d p0x = _mm256_set1_pd(query.p0.x());
+  const __m256d p0y = _mm256_set1_pd(query.p0.y());
+  const __m256d p1x = _mm256_set1_pd(query.p1.x());
+  const __m256d p1y = _mm256_set1_pd(query.p1.y());
+  const __m256d min_x = _mm256_set1_pd(query.min_x);
+  const __m256d min_y = _mm256_set1_pd(query.min_y);
+  const __m256d max_x = _mm256_set1_pd(query.max_x);
+  const __m256d max_y = _mm256_set1_pd(query.max_y);
+  const __m256d query_distinct = _mm256_castsi256_pd(_mm256_set1_epi64x(query.p0 != query.p1 ? -1 : 0));
+  for (; begin + 4 <= end; begin += 4) {
+    const __m256d reached = _mm256_and_pd(
+        _mm256_and_pd(_mm256_cmp_pd(min_x, _mm256_loadu_pd(&block.min_x_bound[begin]), _CMP_NGT_UQ),
+                      _mm256_cmp_pd(min_y, _mm256_loadu_pd(&block.min_y_bound[begin]), _CMP_NGT_UQ)),
+        _mm256_and_pd(_mm256_cmp_pd(max_x, _mm256_loadu_pd(&block.max_x_bound[begin]), _CMP_NLT_UQ),
+                      _mm256_cmp_pd(max_y, _mm256_loadu_pd(&block.max_y_bound[begin]), _CMP_NLT_UQ)));
+    if (_mm256_movemask_pd(reached) == 0) {
+      continue;
+    }
+    const __m256d p2x = _mm256_loadu_pd(&block.x0[begin]);
+    const __m256d p2y = _mm256_loadu_pd(&block.y0[begin]);
+    const __m256d p3x = _mm256_loadu_pd(&block.x1[begin]);
+    const __m256d p3y = _mm256_loadu_pd(&block.y1[begin]);
+    const __m256d left012 = is_left_avx2(p0x, p0y, p1x, p1y, p2x, p2y);
+    const __m256d left013 = is_left_avx2(p0x, p0y, p1x, p1y, p3x, p3y);
+    const __m256d left230 = is_left_avx2(p2x, p2y, p3x, p3y, p0x, p0y);
+    const __m256d left231 = is_left_avx2(p2x, p2y, p3x, p3y, p1x, p1y);
+    const __m256d not_crossing = _mm256_or_pd(
+        same_avx2(_mm256_cmp_pd(left012, zero, _CMP_GT_OQ), _mm256_cmp_pd(left013, zero, _CMP_GT_OQ)),
+        same_avx2(_mm256_cmp_pd(left230, zero, _CMP_GT_OQ), _mm256_cmp_pd(left231, zero, _CMP_GT_OQ)));
+    const __m256d touching = _mm256_and_pd(_mm256_cmp_pd(p1x, p2x, _CMP_EQ_OQ),
+                                           _mm256_cmp_pd(p1y, p2y, _CMP_EQ_OQ));
+    __m256d hit = _mm256_and_pd(
+        reached, _mm256_or_pd(_mm256_andnot_pd(not_crossing, ones_avx2()), touching));
+    // The rest only matters if a point is on the line of the other segment.
+    const __m256d on_line = _mm256_or_pd(
+        _mm256_or_pd(_mm256_cmp_pd(left012, zero, _CMP_EQ_OQ), _mm256_cmp_pd(left013, zero, _CMP_EQ_OQ)),
+        _mm256_or_pd(_mm256_cmp_pd(left230, zero, _CMP_EQ_OQ), _mm256_cmp_pd(left231, zero, _CMP_EQ_OQ)));
+    if (_mm256_movemask_pd(_mm256_and_pd(reached, on_line)) != 0) {
+      const __m256d on_query = _mm256_and_pd(
+          query_distinct,
+          _mm256_or_pd(_mm256_and_pd(_mm256_cmp_pd(left012, zero, _CMP_EQ_OQ),
+                                     _mm256_and_pd(is_between_avx2(p0x, p2x, p1x),
+                                                   is_between_avx2(p0y, p2y, p1y))),
+                       _mm256_and_pd(_mm256_cmp_pd(left013, zero, _CMP_EQ_OQ),
+                                     _mm256_and_pd(is_between_avx2(p0x, p3x, p1x),
+                                                   is_between_avx2(p0y, p3y, p1y)))));
+      const __m256d segment_distinct = _mm256_andnot_pd(
+          _mm256_and_pd(_mm256_cmp_pd(p2x, p3x, _CMP_EQ_OQ), _mm256_cmp_pd(p2y, p3y, _CMP_EQ_OQ)),
+          ones_avx2());
+      const __m256d on_segment = _mm256_and_pd(
+          segment_distinct,
+          _mm256_or_pd(_mm256_and_pd(_mm256_cmp_pd(left230, zero, _CMP_EQ_OQ),
+                                     _mm256_and_pd(is_between_avx2(p2x, p0x, p3x),
+                                                   is_between_avx2(p2y, p0y, p3y))),
+                       _mm256_and_pd(_mm256_cmp_pd(left231, zero, _CMP_EQ_OQ),
+                                     _mm256_and_pd(is_between_avx2(p2x, p1x, p3x),
+                                                   is_between_avx2(p2y, p1y, p3y)))));
+      hit = _mm256_or_pd(hit, _mm256_and_pd(reached, _mm256_or_pd(on_query, on_segment)));
+    }
+    if (_mm256_movemask_pd(hit) != 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Counts four edges at a time from begin and leaves begin at the ones
+// that are left.
+TARGET_AVX2 int winding_number_avx2(const point_type_fp& point, const ring_type_fp& ring,
+                                    size_t& begin) {
+  const __m256d zero = _mm256_setzero_pd();
+  const __m256d px = _mm256_set1_pd(point.x());
+  const __m256d py = _mm256_set1_pd(point.y());
+  const coordinate_type_fp* xy = coordinates(ring);
+  int winding_number = 0;
+  for (; begin + 5 <= ring.size(); begin += 4) {
+    // The lanes are the edges starting at begin, begin+2, begin+1 and
+    // begin+3, which doesn't matter for counting them.
+    const __m256d p01 = _mm256_loadu_pd(xy + 2*begin);
+    const __m256d p23 = _mm256_loadu_pd(xy + 2*begin + 4);
+    const __m256d p12 = _mm256_loadu_pd(xy + 2*begin + 2);
+    const __m256d p34 = _mm256_loadu_pd(xy + 2*begin + 6);
+    const __m256d y0 = _mm256_unpackhi_pd(p01, p23);
+    const __m256d y1 = _mm256_unpackhi_pd(p12, p34);
+    const __m256d start_below = _mm256_cmp_pd(y0, py, _CMP_LE_OQ);
+    const __m256d end_below = _mm256_cmp_pd(y1, py, _CMP_LE_OQ);
+    // Most edges don't cross the horizontal line through the point.
+    if (_mm256_movemask_pd(_mm256_xor_pd(start_below, end_below)) == 0) {
+      continue;
+    }
+    const __m256d left = is_left_avx2(_mm256_unpacklo_pd(p01, p23), y0,
+                                      _mm256_unpacklo_pd(p12, p34), y1, px, py);
+    const __m256d up = _mm256_and_pd(start_below,
+                                     _mm256_and_pd(_mm256_cmp_pd(y1, py, _CMP_GT_OQ),
+                                                   _mm256_cmp_pd(left, zero, _CMP_GT_OQ)));
+    const __m256d down = _mm256_andnot_pd(start_below,
+                                          _mm256_and_pd(end_below,
+                                                        _mm256_cmp_pd(left, zero, _CMP_LT_OQ)));
+    winding_number += lanes_set(_mm256_movemask_pd(up));
+    winding_number -= lanes_set(_mm256_movemask_pd(down));
+  }
+  return winding_number;
+}
+
+#endif // BATCH_INTERSECT_X86
+
+} // namespace
+
+const vector<Kernel>& supported_kernels() {
+  static const vector<Kernel> kernels = []() {
+    vector<Kernel> ret{Kernel::scalar};
+#ifdef BATCH_INTERSECT_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) {
+      ret.push_back(Kernel::sse2);
+    }
+    if (__builtin_cpu_supports("avx2")) {
+      ret.push_back(Kernel::avx2);
+    }
+#endif
+    return ret;
+  }();
+  return kernels;
+}
+
+Kernel best_kernel() {
+  static const Kernel best = supported_kernels().back();
+  return best;
+}
+
+void SegmentBlock::push_back(const point_type_fp& first, const point_type_fp& second) {
+  push_back(first, second,
+            std::numeric_limits<coordinate_type_fp>::infinity(),
+            std::numeric_limits<coordinate_type_fp>::infinity(),
+            -std::numeric_limits<coordinate_type_fp>::infinity(),
+            -std::numeric_limits<coordinate_type_fp>::infinity());
+}
+
+void SegmentBlock::push_back(const point_type_fp& first, const point_type_fp& second,
+                             coordinate_type_fp min_x_bound, coordinate_type_fp min_y_bound,
+                             coordinate_type_fp max_x_bound, coordinate_type_fp max_y_bound) {
+  x0.push_back(first.x());
+  y0.push_back(first.y());
+  x1.push_back(second.x());
+  y1.push_back(second.y());
+  this->min_x_bound.push_back(min_x_bound);
+  this->min_y_bound.push_back(min_y_bound);
+  this->max_x_bound.push_back(max_x_bound);
+  this->max_y_bound.push_back(max_y_bound);
+}
+
+void SegmentBlock::reserve(size_t size) {
+  for (auto* v : {&x0, &y0, &x1, &y1, &min_x_bound, &min_y_bound, &max_x_bound, &max_y_bound}) {
+    v->reserve(size);
+  }
+}
+
+bool any_intersecting(const point_type_fp& p0, const point_type_fp& p1,
+                      const SegmentBlock& block, size_t begin, size_t end,
+                      Kernel kernel) {
+  const Query query(p0, p1);
+#ifdef BATCH_INTERSECT_X86
+  if (kernel == Kernel::avx2 && any_intersecting_avx2(query, block, begin, end)) {
+    return true;
+  }
+  if (kernel != Kernel::scalar && any_intersecting_sse2(query, block, begin, end)) {
+    return true;
+  }
+#else
+  (void) kernel;
+#endif
+  return any_intersecting_scalar(query, block, begin, end);
+}
+
+int winding_number(const point_type_fp& point, const ring_type_fp& ring, Kernel kernel) {
+  size_t begin = 0;
+  int winding_number = 0;
+#ifdef BATCH_INTERSECT_X86
+  if (kernel == Kernel::avx2) {
+    winding_number += winding_number_avx2(point, ring, begin);
+  }
+  if (kernel != Kernel::scalar) {
+    winding_number += winding_number_sse2(point, ring, begin);
+  }
+#else
+  (void) kernel;
+#endif
+  return winding_number + winding_number_scalar(point, ring, begin);
+}
+
+} // namespace batch_intersect
@@ -0,0 +1,68 @@
+#ifndef BATCH_INTERSECT_HPP
+#define BATCH_INTERSECT_HPP
+
+#include <vector>
+
+#include "geometry.hpp"
+
+// Tests one segment or point against many segments at once.  Where
+// the processor has them, SSE2 or AVX2 instructions test several
+// segments at a time.  The results are exactly the same as testing
+// them one at a time with path_finding::is_intersecting and
+// path_finding::point_in_ring.
+namespace batch_intersect {
+
+enum class Kernel {
+  scalar,
+  sse2,
+  avx2,
+};
+
+// The kernels that can run on this processor, from slowest to fastest.
+// When the compiler is allowed to fuse multiplies and adds, the
+// scalar code might round differently so only scalar is available.
+const std::vector<Kernel>& supported_kernels();
+// The last of the above.
+Kernel best_kernel();
+
+// Segments stored as a structure of arrays so that they can be loaded
+// several at a time.
+struct SegmentBlock {
+  // The segment is tested against every query.
+  void push_back(const point_type_fp& first, const point_type_fp& second);
+  // The segment is only tested against a query if the query's
+  // bounding box has min_x <= min_x_bound, min_y <= min_y_bound,
+  // max_x >= max_x_bound and max_y >= max_y_bound.
+  void push_back(const point_type_fp& first, const point_type_fp& second,
+                 coordinate_type_fp min_x_bound, coordinate_type_fp min_y_bound,
+                 coordinate_type_fp max_x_bound, coordinate_type_fp max_y_bound);
+  void reserve(size_t size);
+  size_t size() const { return x0.size(); }
+  point_type_fp first(size_t i) const { return point_type_fp(x0[i], y0[i]); }
+  point_type_fp second(size_t i) const { return point_type_fp(x1[i], y1[i]); }
+
+  std::vector<coordinate_type_fp> x0;
+  std::vector<coordinate_type_fp> y0;
+  std::vector<coordinate_type_fp> x1;
+  std::vector<coordinate_type_fp> y1;
+  std::vector<coordinate_type_fp> min_x_bound;
+  std::vector<coordinate_type_fp> min_y_bound;
+  std::vector<coordinate_type_fp> max_x_bound;
+  std::vector<coordinate_type_fp> max_y_bound;
+};
+
+// Returns true if any of the segments from begin to end in the block
+// is within its bounds and intersects p0 to p1, as in
+// path_finding::is_intersecting(p0, p1, first, second).
+bool any_intersecting(const point_type_fp& p0, const point_type_fp& p1,
+                      const SegmentBlock& block, size_t begin, size_t end,
+                      Kernel kernel = best_kernel());
+
+// The winding number of the ring around the point.  It's non-zero if
+// the point is inside.
+int winding_number(const point_type_fp& point, const ring_type_fp& ring,
+                   Kernel kernel = best_kernel());
+
+} // namespace batch_intersect
+
+#endif //BATCH_INTERSECT_HPP
@@ -0,0 +1,101 @@
+#define BOOST_TEST_MODULE batch intersect tests
+#include <boost/test/unit_test.hpp>
+
+#include <random>
+#include <vector>
+
+#include "geometry.hpp"
+#include "batch_intersect.hpp"
+#include "path_finding.hpp"
+
+using std::vector;
+using namespace batch_intersect;
+
+BOOST_AUTO_TEST_SUITE(batch_intersect_tests)
+
+// Small integers make lots of collinear and touching segments.  The
+// others are on a line that can't be represented exactly.
+static point_type_fp random_point(std::mt19937& gen, int kind) {
+  std::uniform_int_distribution<int> small(0, 6);
+  std::uniform_real_distribution<double> real(0, 10);
+  switch (kind % 3) {
+    case 0:
+      return point_type_fp(small(gen), small(gen));
+    case 1: {
+      const double t = real(gen);
+      return point_type_fp(t, t / 3 + 0.1);
+    }
+    default:
+      return point_type_fp(real(gen), real(gen));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(any_intersecting_matches_scalar) {
+  std::mt19937 gen(1);
+  BOOST_REQUIRE(supported_kernels().front() == Kernel::scalar);
+  for (int kind = 0; kind < 30; kind++) {
+    SegmentBlock block;
+    vector<std::pair<point_type_fp, point_type_fp>> segments;
+    for (int i = 0; i < 11; i++) {
+      segments.emplace_back(random_point(gen, kind), random_point(gen, kind));
+      block.push_back(segments.back().first, segments.back().second);
+    }
+    for (int query = 0; query < 200; query++) {
+      const auto p0 = random_point(gen, kind);
+      const auto p1 = query % 10 == 0 ? p0 : random_point(gen, kind);
+      for (size_t begin = 0; begin < segments.size(); begin++) {
+        for (size_t end = begin; end <= segments.size(); end++) {
+          bool expected = false;
+          for (size_t i = begin; i < end; i++) {
+            expected = expected || path_finding::is_intersecting(p0, p1, segments[i].first, segments[i].second);
+          }
+          for (const auto kernel : supported_kernels()) {
+            BOOST_CHECK_EQUAL(any_intersecting(p0, p1, block, begin, end, kernel), expected);
+          }
+        }
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(bounds) {
+  SegmentBlock block;
+  // Crosses the query but the query's max_x is less than 5.
+  block.push_back(point_type_fp(0, 0), point_type_fp(4, 4), 10, 10, 5, -10);
+  for (int i = 0; i < 4; i++) {
+    block.push_back(point_type_fp(0, 10), point_type_fp(4, 10));
+  }
+  for (const auto kernel : supported_kernels()) {
+    BOOST_CHECK(!any_intersecting(point_type_fp(0, 4), point_type_fp(4, 0), block, 0, 5, kernel));
+    BOOST_CHECK(any_intersecting(point_type_fp(0, 4), point_type_fp(6, -2), block, 0, 5, kernel));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(winding_number_matches_scalar) {
+  std::mt19937 gen(2);
+  for (int kind = 0; kind < 30; kind++) {
+    for (size_t size = 0; size < 12; size++) {
+      ring_type_fp ring;
+      for (size_t i = 0; i < size; i++) {
+        ring.push_back(random_point(gen, kind));
+      }
+      if (size > 0) {
+        ring.push_back(ring.front());
+      }
+      for (int query = 0; query < 50; query++) {
+        const auto p = random_point(gen, kind);
+        const int expected = winding_number(p, ring, Kernel::scalar);
+        for (const auto kernel : supported_kernels()) {
+          BOOST_CHECK_EQUAL(winding_number(p, ring, kernel), expected);
+        }
+      }
+    }
+  }
+  ring_type_fp square{{0, 0}, {0, 10}, {10, 10}, {10, 0}, {0, 0}};
+  for (const auto kernel : supported_kernels()) {
+    BOOST_CHECK_EQUAL(winding_number(point_type_fp(5, 5), square, kernel), -1);
+    BOOST_CHECK_EQUAL(winding_number(point_type_fp(15, 5), square, kernel), 0);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
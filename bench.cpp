@@ -0,0 +1,310 @@
+// Micro-benchmarks for the geometry hot paths, on synthetic inputs of
+// a few sizes.  The inputs are made from a fixed seed so they are the
+// same in every run.  Results are written to stdout as JSON, one
+// entry per benchmark and size, so that they can be compared between
+// commits.
+//
+// Usage: pcb2gcode_bench [--filter SUBSTRING] [--min-time SECONDS]
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#include "geometry.hpp"
+#include "bg_operators.hpp"
+#include "bg_helpers.hpp"
+#include "backtrack.hpp"
+#include "eulerian_paths.hpp"
+#include "path_finding.hpp"
+#include "segment_tree.hpp"
+#include "segmentize.hpp"
+#include "tsp_solver.hpp"
+#include "voronoi.hpp"
+
+using std::function;
+using std::pair;
+using std::string;
+using std::vector;
+
+namespace {
+
+// A benchmark makes its input for a size and returns the work to be
+// timed and how many items that work processes.
+struct Benchmark {
+  string name;
+  vector<size_t> sizes;
+  function<pair<function<void()>, size_t>(size_t)> setup;
+};
+
+struct Result {
+  string name;
+  size_t size;
+  size_t iterations;
+  double seconds;
+  size_t items;
+};
+
+// Keeps the compiler from optimizing away unused results.
+volatile size_t sink;
+
+std::mt19937 make_random() {
+  return std::mt19937(1234);
+}
+
+// n random points in a square of side n.
+vector<point_type_fp> random_points(size_t n) {
+  auto random = make_random();
+  std::uniform_real_distribution<double> coordinate(0, n);
+  vector<point_type_fp> points;
+  points.reserve(n);
+  for (size_t i = 0; i < n; i++) {
+    const double x = coordinate(random);
+    points.emplace_back(x, coordinate(random));
+  }
+  return points;
+}
+
+// n random segments, each up to 10 long, in a square of side n.
+vector<pair<point_type_fp, point_type_fp>> random_segments(size_t n) {
+  auto random = make_random();
+  std::uniform_real_distribution<double> coordinate(0, n);
+  std::uniform_real_distribution<double> delta(-5, 5);
+  vector<pair<point_type_fp, point_type_fp>> segments;
+  segments.reserve(n);
+  for (size_t i = 0; i < n; i++) {
+    const double x = coordinate(random);
+    const double y = coordinate(random);
+    const double dx = delta(random);
+    segments.emplace_back(point_type_fp(x, y), point_type_fp(x + dx, y + delta(random)));
+  }
+  return segments;
+}
+
+// The lines of a grid with side cells on each side, as reversible
+// paths with one segment per cell edge, like the output of
+// segmentize.  This is the worst case for eulerian paths and
+// backtracking because every inner vertex has four edges.
+vector<pair<linestring_type_fp, bool>> grid_paths(size_t side) {
+  vector<pair<linestring_type_fp, bool>> paths;
+  for (size_t i = 0; i <= side; i++) {
+    for (size_t j = 0; j < side; j++) {
+      paths.push_back({linestring_type_fp{{double(i), double(j)}, {double(i), double(j + 1)}}, true});
+      paths.push_back({linestring_type_fp{{double(j), double(i)}, {double(j + 1), double(i)}}, true});
+    }
+  }
+  return paths;
+}
+
+// side*side squares, each 0.6 wide and 1 apart.
+multi_polygon_type_fp grid_squares(size_t side) {
+  multi_polygon_type_fp squares;
+  for (size_t i = 0; i < side; i++) {
+    for (size_t j = 0; j < side; j++) {
+      const double x = i;
+      const double y = j;
+      polygon_type_fp square;
+      bg::convert(box_type_fp({x, y}, {x + 0.6, y + 0.6}), square);
+      squares.push_back(square);
+    }
+  }
+  return squares;
+}
+
+vector<Benchmark> benchmarks() {
+  return {
+    {"segment_tree_intersects", {1000, 10000, 100000}, [](size_t n) {
+       auto tree = std::make_shared<segment_tree::SegmentTree>(random_segments(n));
+       const auto queries = std::make_shared<vector<pair<point_type_fp, point_type_fp>>>(random_segments(1000));
+       for (auto& query : *queries) {
+         query.second = point_type_fp(query.first.x() + (query.second.x() - query.first.x()) / 10,
+                                      query.first.y() + (query.second.y() - query.first.y()) / 10);
+       }
+       return std::make_pair([tree, queries]() {
+                               size_t count = 0;
+                               for (const auto& query : *queries) {
+                                 count += tree->intersects(query.first, query.second);
+                               }
+                               sink = count;
+                             }, queries->size());
+     }},
+    {"point_in_ring", {100, 1000, 10000}, [](size_t n) {
+       // A circle of n points and random points around it.
+       auto ring = std::make_shared<ring_type_fp>();
+       for (size_t i = 0; i < n; i++) {
+         const double angle = 2 * bg::math::pi<double>() * i / n;
+         ring->push_back(point_type_fp(std::cos(angle) * n, std::sin(angle) * n));
+       }
+       ring->push_back(ring->front());
+       auto points = std::make_shared<vector<point_type_fp>>(random_points(1000));
+       for (auto& point : *points) {
+         point = point_type_fp(point.x() * 2 * n / 1000 - n, point.y() * 2 * n / 1000 - n);
+       }
+       return std::make_pair([ring, points]() {
+                               size_t count = 0;
+                               for (const auto& point : *points) {
+                                 count += path_finding::point_in_ring(point, *ring);
+                               }
+                               sink = count;
+                             }, points->size());
+     }},
+    {"find_path", {5, 10, 20}, [](size_t side) {
+       // Paths between gaps across a grid of keep out squares.
+       auto surface = std::make_shared<path_finding::PathFindingSurface>(
+           boost::none, grid_squares(side), 0.01);
+       auto random = make_random();
+       std::uniform_int_distribution<size_t> cell(0, side - 1);
+       auto ends = std::make_shared<vector<pair<point_type_fp, point_type_fp>>>();
+       for (size_t i = 0; i < 20; i++) {
+         ends->emplace_back(point_type_fp(cell(random) + 0.8, cell(random) + 0.8),
+                            point_type_fp(cell(random) + 0.8, cell(random) + 0.8));
+       }
+       return std::make_pair([surface, ends]() {
+                               size_t count = 0;
+                               for (const auto& e : *ends) {
+                                 const auto path = surface->find_path(
+                                     e.first, e.second, std::numeric_limits<coordinate_type_fp>::infinity(),
+                                     boost::make_optional<size_t>(100000));
+                                 count += path ? path->size() : 0;
+                               }
+                               sink = count;
+                             }, ends->size());
+     }},
+    {"get_eulerian_paths", {10, 100, 300}, [](size_t side) {
+       const auto paths = std::make_shared<vector<pair<linestring_type_fp, bool>>>(grid_paths(side));
+       return std::make_pair([paths]() {
+                               sink = eulerian_paths::get_eulerian_paths<
+                                 point_type_fp, linestring_type_fp>(*paths).size();
+                             }, paths->size());
+     }},
+    {"backtrack", {10, 100, 300}, [](size_t side) {
+       const auto paths = std::make_shared<vector<pair<linestring_type_fp, bool>>>(grid_paths(side));
+       return std::make_pair([paths]() {
+                               sink = backtrack::backtrack(*paths, 1, 1, 10, 1, 5).size();
+                             }, paths->size());
+     }},
+    {"segmentize_paths", {100, 1000, 10000}, [](size_t n) {
+       auto paths = std::make_shared<vector<pair<linestring_type_fp, bool>>>();
+       for (const auto& segment : random_segments(n)) {
+         paths->push_back({linestring_type_fp{segment.first, segment.second}, true});
+       }
+       return std::make_pair([paths]() {
+                               sink = segmentize::segmentize_paths(*paths).size();
+                             }, paths->size());
+     }},
+    {"build_voronoi", {10, 30, 100}, [](size_t side) {
+       const auto squares = std::make_shared<multi_polygon_type_fp>(grid_squares(side));
+       const box_type_fp bounding_box({-1, -1}, {side + 1.0, side + 1.0});
+       return std::make_pair([squares, bounding_box]() {
+                               sink = Voronoi::build_voronoi(*squares, bounding_box, 0.01).size();
+                             }, squares->size());
+     }},
+    {"build_voronoi_tiled", {10, 30, 100}, [](size_t side) {
+       const auto squares = std::make_shared<multi_polygon_type_fp>(grid_squares(side));
+       const box_type_fp bounding_box({-1, -1}, {side + 1.0, side + 1.0});
+       return std::make_pair([squares, bounding_box]() {
+                               sink = Voronoi::build_voronoi(*squares, bounding_box, 0.01, 4, nullptr, 1.0).size();
+                             }, squares->size());
+     }},
+    {"buffer", {100, 300, 1000}, [](size_t n) {
+       auto lines = std::make_shared<multi_linestring_type_fp>();
+       for (const auto& segment : random_segments(n)) {
+         lines->push_back(linestring_type_fp{segment.first, segment.second});
+       }
+       return std::make_pair([lines]() {
+                               sink = bg_helpers::buffer(*lines, 0.1).size();
+                             }, lines->size());
+     }},
+    {"tsp_nearest_neighbour", {1000, 10000, 100000}, [](size_t n) {
+       const auto points = std::make_shared<vector<point_type_fp>>(random_points(n));
+       return std::make_pair([points]() {
+                               auto path = *points;
+                               tsp_solver::nearest_neighbour_kd_tree(path, point_type_fp(0, 0));
+                               sink = path.size();
+                             }, n);
+     }},
+    {"tsp_2opt", {100, 1000, 10000}, [](size_t n) {
+       const auto points = std::make_shared<vector<point_type_fp>>(random_points(n));
+       return std::make_pair([points]() {
+                               auto path = *points;
+                               sink = tsp_solver::tsp_2opt(path, point_type_fp(0, 0), 10).iterations;
+                             }, n);
+     }},
+  };
+}
+
+Result run(const Benchmark& benchmark, size_t size, double min_time) {
+  const auto work = benchmark.setup(size);
+  Result result{benchmark.name, size, 0, 0, 0};
+  // Run at least once and then until min_time has passed.
+  const auto start = std::chrono::steady_clock::now();
+  do {
+    work.first();
+    result.iterations++;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  } while (result.seconds < min_time);
+  result.items = work.second;
+  return result;
+}
+
+void print_json(const vector<Result>& results) {
+  std::ostringstream json;
+  json << std::setprecision(6);
+  json << "{\n  \"benchmarks\": [";
+  for (size_t i = 0; i < results.size(); i++) {
+    const auto& r = results[i];
+    const double per_iteration = r.seconds / r.iterations;
+    json << (i == 0 ? "\n" : ",\n")
+         << "    {\"name\": \"" << r.name << "/" << r.size << "\""
+         << ", \"benchmark\": \"" << r.name << "\""
+         << ", \"size\": " << r.size
+         << ", \"iterations\": " << r.iterations
+         << ", \"seconds_per_iteration\": " << per_iteration
+         << ", \"items_per_second\": " << r.items / per_iteration << "}";
+  }
+  json << (results.empty() ? "]\n}\n" : "\n  ]\n}\n");
+  std::cout << json.str();
+}
+
+} // namespace
+
+int main(int argc, const char* argv[]) {
+  string filter;
+  double min_time = 0.5;
+  for (int i = 1; i < argc; i++) {
+    const string arg = argv[i];
+    if (arg == "--filter" && i + 1 < argc) {
+      filter = argv[++i];
+    } else if (arg == "--min-time" && i + 1 < argc) {
+      min_time = std::atof(argv[++i]);
+    } else {
+      std::cerr << "Usage: " << argv[0] << " [--filter SUBSTRING] [--min-time SECONDS]" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  vector<Result> results;
+  for (const auto& benchmark : benchmarks()) {
+    for (const auto size : benchmark.sizes) {
+      const string name = benchmark.name + "/" + std::to_string(size);
+      if (name.find(filter) == string::npos) {
+        continue;
+      }
+      std::cerr << name << "... " << std::flush;
+      results.push_back(run(benchmark, size, min_time));
+      std::cerr << results.back().seconds / results.back().iterations << "s" << std::endl;
+    }
+  }
+  print_json(results);
+  return 0;
+}
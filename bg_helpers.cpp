@@ -1,8 +1,12 @@
 #include "eulerian_paths.hpp"
 #ifdef GEOS_VERSION
 #include <geos/operation/buffer/BufferOp.h>
+#include <geos/geom/GeometryFactory.h>
 #include "geos_helpers.hpp"
 #endif // GEOS_VERSION
+#ifdef USE_CLIPPER2
+#include "clipper_helpers.hpp"
+#endif // USE_CLIPPER2
 
 #include "bg_operators.hpp"
 #include "bg_helpers.hpp"
@@ -19,7 +23,9 @@ multi_polygon_type_fp buffer(multi_polygon_type_fp const & geometry_in, coordina
   if (expand_by == 0 || geometry_in.size() == 0) {
     return geometry_in;
   }
-#ifdef GEOS_VERSION
+#if defined(USE_CLIPPER2)
+  return clipper_helpers::buffer(geometry_in, expand_by);
+#elif defined(GEOS_VERSION)
   auto geos_in = to_geos(geometry_in);
   return from_geos<multi_polygon_type_fp>(
       std::unique_ptr<geos::geom::Geometry>(
@@ -119,4 +125,129 @@ multi_polygon_type_fp buffer_miter(ring_type_fp const & geometry_in, CoordinateT
 
 template multi_polygon_type_fp buffer_miter(ring_type_fp const&, double);
 
+LazyMultiPolygon::LazyMultiPolygon() :
+    mpoly(std::make_shared<const multi_polygon_type_fp>()) {}
+
+LazyMultiPolygon::LazyMultiPolygon(multi_polygon_type_fp mpoly) :
+    mpoly(std::make_shared<const multi_polygon_type_fp>(std::move(mpoly))) {}
+
+const multi_polygon_type_fp& LazyMultiPolygon::get() const {
+#if defined(GEOS_VERSION) && !defined(USE_CLIPPER2)
+  if (!mpoly) {
+    mpoly = std::make_shared<const multi_polygon_type_fp>(
+        from_geos<multi_polygon_type_fp>(geos_geometry.get()));
+  }
+#endif // GEOS_VERSION && !USE_CLIPPER2
+  return *mpoly;
+}
+
+#if defined(GEOS_VERSION) && !defined(USE_CLIPPER2)
+
+namespace {
+
+// Where the inputs only touch, geos can give back lines and points
+// and older versions of geos put them in a GeometryCollection with
+// the polygons.  Boost geometry drops them so they're dropped here.
+std::shared_ptr<const geos::geom::Geometry> polygonal(std::unique_ptr<geos::geom::Geometry> g) {
+  if (dynamic_cast<const geos::geom::Polygon*>(g.get()) ||
+      dynamic_cast<const geos::geom::MultiPolygon*>(g.get())) {
+    return std::move(g);
+  }
+  std::vector<std::unique_ptr<geos::geom::Polygon>> polys;
+  for (size_t i = 0; i < g->getNumGeometries(); i++) {
+    if (auto poly = dynamic_cast<const geos::geom::Polygon*>(g->getGeometryN(i))) {
+      polys.emplace_back(static_cast<geos::geom::Polygon*>(poly->clone().release()));
+    }
+  }
+  return g->getFactory()->createMultiPolygon(std::move(polys));
+}
+
+} // namespace
+
+LazyMultiPolygon::LazyMultiPolygon(std::shared_ptr<const geos::geom::Geometry> geos_geometry) :
+    geos_geometry(std::move(geos_geometry)) {}
+
+const geos::geom::Geometry* LazyMultiPolygon::get_geos() const {
+  if (!geos_geometry) {
+    geos_geometry = to_geos(*mpoly);
+  }
+  return geos_geometry.get();
+}
+
+// The same as bg::area but without converting from geos.
+coordinate_type_fp LazyMultiPolygon::area() const {
+  if (mpoly) {
+    return bg::area(*mpoly);
+  }
+  return geos_geometry->getArea();
+}
+
+LazyMultiPolygon LazyMultiPolygon::operator+(const LazyMultiPolygon& rhs) const {
+  // The same as operator+ on multi_polygon_type_fp.
+  if (rhs.area() <= 0) {
+    return *this;
+  }
+  if (area() <= 0) {
+    return rhs;
+  }
+  return LazyMultiPolygon(std::shared_ptr<const geos::geom::Geometry>(
+      get_geos()->Union(rhs.get_geos())));
+}
+
+LazyMultiPolygon LazyMultiPolygon::operator&(const LazyMultiPolygon& rhs) const {
+  // The same as operator& on multi_polygon_type_fp.
+  if (rhs.area() <= 0 || area() <= 0) {
+    return LazyMultiPolygon();
+  }
+  return LazyMultiPolygon(polygonal(get_geos()->intersection(rhs.get_geos())));
+}
+
+LazyMultiPolygon LazyMultiPolygon::operator-(const LazyMultiPolygon& rhs) const {
+  // The same as operator- on multi_polygon_type_fp.
+  if (rhs.area() <= 0) {
+    return *this;
+  }
+  return LazyMultiPolygon(polygonal(get_geos()->difference(rhs.get_geos())));
+}
+
+LazyMultiPolygon LazyMultiPolygon::buffer(coordinate_type_fp expand_by) const {
+  // The same as buffer on multi_polygon_type_fp.
+  if (expand_by == 0 || (mpoly ? mpoly->size() == 0 : geos_geometry->isEmpty())) {
+    return *this;
+  }
+  return LazyMultiPolygon(std::shared_ptr<const geos::geom::Geometry>(
+      geos::operation::buffer::BufferOp::bufferOp(get_geos(), expand_by, points_per_circle/4)));
+}
+
+#else // !GEOS_VERSION || USE_CLIPPER2
+
+LazyMultiPolygon LazyMultiPolygon::operator+(const LazyMultiPolygon& rhs) const {
+  return LazyMultiPolygon(get() + rhs.get());
+}
+
+LazyMultiPolygon LazyMultiPolygon::operator&(const LazyMultiPolygon& rhs) const {
+  return LazyMultiPolygon(get() & rhs.get());
+}
+
+LazyMultiPolygon LazyMultiPolygon::operator-(const LazyMultiPolygon& rhs) const {
+  return LazyMultiPolygon(get() - rhs.get());
+}
+
+LazyMultiPolygon LazyMultiPolygon::buffer(coordinate_type_fp expand_by) const {
+  return LazyMultiPolygon(bg_helpers::buffer(get(), expand_by));
+}
+
+#endif // GEOS_VERSION && !USE_CLIPPER2
+
+MultiBuffer::MultiBuffer(const multi_polygon_type_fp& geometry) :
+    geometry(geometry) {}
+
+const LazyMultiPolygon& MultiBuffer::operator()(coordinate_type_fp expand_by) {
+  const auto found = results.find(expand_by);
+  if (found != results.cend()) {
+    return found->second;
+  }
+  return results.emplace(expand_by, geometry.buffer(expand_by)).first->second;
+}
+
 } // namespace bg_helpers
@@ -3,6 +3,11 @@
 
 #include "eulerian_paths.hpp"
 #include <boost/functional/hash/hash.hpp>
+#include <map>
+#include <memory>
+#ifdef GEOS_VERSION
+#include <geos/geom/Geometry.h>
+#endif // GEOS_VERSION
 
 namespace bg_helpers {
 
@@ -26,6 +31,49 @@ multi_polygon_type_fp buffer(ring_type_fp const & geometry_in, CoordinateType ex
 template<typename CoordinateType>
 multi_polygon_type_fp buffer_miter(ring_type_fp const & geometry_in, CoordinateType expand_by);
 
+// A multi_polygon that is kept in the form that the operation that
+// made it used, boost geometry or geos, and only converted to the
+// other form when that is needed.  With geos, all the operations
+// below are done in geos so a chain of them stays in geos until get()
+// is called.  The shapes are the same as from the operators and buffer
+// above, though the rings of an intersection or difference may start
+// at another point.  Copies share both forms.  Without geos this is
+// just a multi_polygon_type_fp.
+class LazyMultiPolygon {
+ public:
+  LazyMultiPolygon();
+  explicit LazyMultiPolygon(multi_polygon_type_fp mpoly);
+  const multi_polygon_type_fp& get() const;
+
+  LazyMultiPolygon operator+(const LazyMultiPolygon& rhs) const;
+  LazyMultiPolygon operator&(const LazyMultiPolygon& rhs) const;
+  LazyMultiPolygon operator-(const LazyMultiPolygon& rhs) const;
+  LazyMultiPolygon buffer(coordinate_type_fp expand_by) const;
+
+ private:
+  mutable std::shared_ptr<const multi_polygon_type_fp> mpoly;
+#if defined(GEOS_VERSION) && !defined(USE_CLIPPER2)
+  explicit LazyMultiPolygon(std::shared_ptr<const geos::geom::Geometry> geos_geometry);
+  const geos::geom::Geometry* get_geos() const;
+  coordinate_type_fp area() const;
+  mutable std::shared_ptr<const geos::geom::Geometry> geos_geometry;
+#endif // GEOS_VERSION && !USE_CLIPPER2
+};
+
+// Buffers of one geometry by several distances, like the passes of
+// isolation milling.  Each result is the same as from buffer but the
+// geometry is only converted once and a distance that was already
+// done is reused.
+class MultiBuffer {
+ public:
+  explicit MultiBuffer(const multi_polygon_type_fp& geometry);
+  const LazyMultiPolygon& operator()(coordinate_type_fp expand_by);
+
+ private:
+  const LazyMultiPolygon geometry;
+  std::map<coordinate_type_fp, LazyMultiPolygon> results;
+};
+
 } // namespace bg_helpers
 
 #endif //BG_HELPERS_HPP
@@ -6,6 +6,9 @@
 #include <geos/geom/GeometryFactory.h>
 #include "geos_helpers.hpp"
 #endif // GEOS_VERSION
+#ifdef USE_CLIPPER2
+#include "clipper_helpers.hpp"
+#endif // USE_CLIPPER2
 
 #include "bg_operators.hpp"
 
@@ -19,9 +22,15 @@ bg::model::multi_polygon<polygon_type_t> operator-(
   if (bg::area(rhs) <= 0) {
     return lhs;
   }
+#ifdef USE_CLIPPER2
+  multi_polygon_type_fp rhs_mp;
+  bg::convert(rhs, rhs_mp);
+  return clipper_helpers::difference(lhs, rhs_mp);
+#else // !USE_CLIPPER2
   bg::model::multi_polygon<polygon_type_t> ret;
   bg::difference(lhs, rhs, ret);
   return ret;
+#endif // USE_CLIPPER2
 }
 
 template multi_polygon_type_fp operator-(const multi_polygon_type_fp&, const multi_polygon_type_fp&);
@@ -95,8 +104,14 @@ bg::model::multi_polygon<polygon_type_t> operator&(const bg::model::multi_polygo
   if (bg::area(lhs) <= 0) {
     return ret;
   }
+#ifdef USE_CLIPPER2
+  multi_polygon_type_fp rhs_mp;
+  bg::convert(rhs, rhs_mp);
+  return clipper_helpers::intersection(lhs, rhs_mp);
+#else // !USE_CLIPPER2
   bg::intersection(lhs, rhs, ret);
   return ret;
+#endif // USE_CLIPPER2
 }
 
 template multi_polygon_type_fp operator&(const multi_polygon_type_fp&, const multi_polygon_type_fp&);
@@ -132,9 +147,13 @@ bg::model::multi_polygon<polygon_type_t> operator^(
   if (bg::area(lhs) <= 0) {
     return rhs;
   }
+#ifdef USE_CLIPPER2
+  return clipper_helpers::symdiff(lhs, rhs);
+#else // !USE_CLIPPER2
   bg::model::multi_polygon<polygon_type_t> ret;
   bg::sym_difference(lhs, rhs, ret);
   return ret;
+#endif // USE_CLIPPER2
 }
 
 template multi_polygon_type_fp operator^(const multi_polygon_type_fp&, const multi_polygon_type_fp&);
@@ -150,7 +169,13 @@ bg::model::multi_polygon<polygon_type_t> operator+(const bg::model::multi_polygo
     bg::convert(rhs, ret);
     return ret;
   }
-#ifdef GEOS_VERSION
+#if defined(USE_CLIPPER2)
+  // Integer clipping doesn't have the problem with bordering shapes
+  // below.
+  multi_polygon_type_fp rhs_mp;
+  bg::convert(rhs, rhs_mp);
+  return clipper_helpers::union_(lhs, rhs_mp);
+#elif defined(GEOS_VERSION)
   auto geos_rhs = to_geos(rhs);
   return from_geos<multi_polygon_type_fp>(to_geos(lhs)->Union(geos_rhs.get()));
 #else // !GEOS_VERSION
@@ -244,7 +269,9 @@ multi_polygon_type_fp sum(const std::vector<multi_polygon_type_fp>& mpolys) {
   } else if (mpolys.size() == 1) {
     return mpolys[0];
   }
-#ifdef GEOS_VERSION
+#if defined(USE_CLIPPER2)
+  return clipper_helpers::sum(mpolys);
+#elif defined(GEOS_VERSION)
   std::vector<std::unique_ptr<geos::geom::Geometry>> geos_mpolys_tmp;
   for (const auto& mpoly : mpolys) {
     if (bg::area(mpoly) == 0) {
@@ -267,9 +294,9 @@ multi_polygon_type_fp sum(const std::vector<multi_polygon_type_fp>& mpolys) {
     std::cerr << "\nError: Internal error with libgeos.  Upgrading geos may help." << std::endl;
     throw;
   }
-#else // !GEOS_VERSION
+#else // !GEOS_VERSION && !USE_CLIPPER2
   return reduce(mpolys, operator+<polygon_type_fp, multi_polygon_type_fp>);
-#endif // GEOS_VERSION
+#endif // USE_CLIPPER2 || GEOS_VERSION
 }
 
 multi_polygon_type_fp symdiff(const std::vector<multi_polygon_type_fp>& mpolys) {
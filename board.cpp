@@ -44,16 +44,21 @@ typedef pair<string, shared_ptr<Layer> > layer_t;
 /*
  */
 /******************************************************************************/
-Board::Board(bool fill_outline, string outputdir, bool tsp_2opt,
+Board::Board(bool fill_outline, string outputdir, string cache_dir, bool tsp_2opt, size_t tsp_2opt_neighbours, double tsp_time_limit,
              MillFeedDirection::MillFeedDirection mill_feed_direction, bool invert_gerbers,
-             bool render_paths_to_shapes) :
+             bool render_paths_to_shapes,
+             shared_ptr<ThreadPool> thread_pool) :
     margin(0.0),
     fill_outline(fill_outline),
     outputdir(outputdir),
+    cache_dir(cache_dir),
     tsp_2opt(tsp_2opt),
+    tsp_2opt_neighbours(tsp_2opt_neighbours),
+    tsp_time_limit(tsp_time_limit),
     mill_feed_direction(mill_feed_direction),
     invert_gerbers(invert_gerbers),
-    render_paths_to_shapes(render_paths_to_shapes) {}
+    render_paths_to_shapes(render_paths_to_shapes),
+    thread_pool(thread_pool) {}
 
 double Board::get_width() {
   if (layers.size() < 1) {
@@ -121,26 +126,33 @@ void Board::createLayers()
     }
 
     // board size calculated. create layers
+    vector<shared_ptr<Layer>> new_layers;
     for (const auto& prepared_layer : prepared_layers) {
       // prepare the surface
-      shared_ptr<GerberImporter> importer = get<0>(prepared_layer.second);
       const bool fill = fill_outline && prepared_layer.first == "outline";
 
       auto surface = make_shared<Surface_vectorial>(
           points_per_circle,
           bounding_box,
-          prepared_layer.first, outputdir, tsp_2opt,
+          prepared_layer.first, outputdir, cache_dir, tsp_2opt, tsp_2opt_neighbours, tsp_time_limit,
           mill_feed_direction, invert_gerbers,
-          render_paths_to_shapes || (prepared_layer.first == "outline"));
+          render_paths_to_shapes || (prepared_layer.first == "outline"),
+          thread_pool);
       if (fill) {
         surface->enable_filling();
       }
-      surface->render(importer, get<1>(prepared_layer.second)->optimise);
-      auto layer = make_shared<Layer>(prepared_layer.first,
-                                      surface,
-                                      get<1>(prepared_layer.second),
-                                      get<2>(prepared_layer.second),
-                                      get<3>(prepared_layer.second)); // see comment for prep_t in board.hpp
+      new_layers.push_back(make_shared<Layer>(prepared_layer.first,
+                                              surface,
+                                              get<1>(prepared_layer.second),
+                                              get<2>(prepared_layer.second),
+                                              get<3>(prepared_layer.second))); // see comment for prep_t in board.hpp
+    }
+    // The layers are independent so they can be rendered at the same time.
+    thread_pool->parallel_for(new_layers.size(), [&](size_t i) {
+      const auto& prepared_layer = prepared_layers.at(new_layers[i]->get_name());
+      new_layers[i]->surface->render(get<0>(prepared_layer), get<1>(prepared_layer)->optimise);
+    });
+    for (const auto& layer : new_layers) {
       layers.insert(std::make_pair(layer->get_name(), layer));
     }
 
@@ -155,12 +167,20 @@ void Board::createLayers()
          get<0>(outline->second)->get_bounding_box().max_corner())) {
       shared_ptr<Layer> outline_layer = layers.at("outline");
 
+      // Masking only reads the outline so all the other layers can be
+      // masked at the same time, now that the outline is rendered.
+      vector<shared_ptr<Layer>> masked_layers;
       for (const auto& layer : layers) {
         if (layer.second != outline_layer) {
-          layer.second->add_mask(outline_layer);
-          layer.second->surface->save_debug_image(string("masked_") + layer.second->get_name());
+          masked_layers.push_back(layer.second);
         }
       }
+      thread_pool->parallel_for(masked_layers.size(), [&](size_t i) {
+        masked_layers[i]->add_mask(outline_layer);
+      });
+      for (const auto& layer : masked_layers) {
+        layer->surface->save_debug_image(string("masked_") + layer->get_name());
+      }
     }
 }
 
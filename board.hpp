@@ -36,6 +36,7 @@
 #include "layer.hpp"
 
 #include "mill.hpp"
+#include "thread_pool.hpp"
 
 /******************************************************************************/
 /*
@@ -50,9 +51,10 @@ class Board
 {
 public:
     Board(bool fill_outline,
-          std::string outputdir, bool tsp_2opt,
+          std::string outputdir, std::string cache_dir, bool tsp_2opt, size_t tsp_2opt_neighbours, double tsp_time_limit,
           MillFeedDirection::MillFeedDirection mill_feed_direction, bool invert_gerbers,
-          bool render_paths_to_shapes);
+          bool render_paths_to_shapes,
+          std::shared_ptr<ThreadPool> thread_pool);
 
     void prepareLayer(std::string layername, std::shared_ptr<GerberImporter> importer,
                       std::shared_ptr<RoutingMill> manufacturer, bool backside, bool ymirror);
@@ -60,6 +62,7 @@ public:
     coordinate_type_fp get_width();
     coordinate_type_fp get_height();
     const box_type_fp& get_bounding_box() const { return bounding_box; }
+    std::shared_ptr<ThreadPool> get_thread_pool() const { return thread_pool; }
     double get_layersnum() {  return layers.size(); }
 
     std::vector<std::string> list_layers();
@@ -72,10 +75,14 @@ private:
     coordinate_type_fp margin;
     const bool fill_outline;
     const std::string outputdir;
+    const std::string cache_dir;
     const bool tsp_2opt;
+    const size_t tsp_2opt_neighbours;
+    const double tsp_time_limit;
     const MillFeedDirection::MillFeedDirection mill_feed_direction;
     const bool invert_gerbers;
     const bool render_paths_to_shapes;
+    const std::shared_ptr<ThreadPool> thread_pool;
 
     box_type_fp bounding_box{{INFINITY, INFINITY}, {-INFINITY, -INFINITY}};
 
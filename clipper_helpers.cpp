@@ -0,0 +1,151 @@
+#ifdef USE_CLIPPER2
+
+#include "clipper_helpers.hpp"
+
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include "common.hpp"
+
+using Clipper2Lib::ClipType;
+using Clipper2Lib::Clipper64;
+using Clipper2Lib::ClipperOffset;
+using Clipper2Lib::EndType;
+using Clipper2Lib::FillRule;
+using Clipper2Lib::JoinType;
+using Clipper2Lib::Path64;
+using Clipper2Lib::Paths64;
+using Clipper2Lib::Point64;
+using Clipper2Lib::PolyPath64;
+using Clipper2Lib::PolyTree64;
+
+static Path64 to_clipper(const ring_type_fp& ring) {
+  Path64 ret;
+  ret.reserve(ring.size());
+  for (const auto& p : ring) {
+    ret.push_back(Point64(std::llround(p.x() * CLIPPER_SCALE), std::llround(p.y() * CLIPPER_SCALE)));
+  }
+  // Clipper2 paths are closed without repeating the first point.
+  if (ret.size() > 1 && ret.front() == ret.back()) {
+    ret.pop_back();
+  }
+  return ret;
+}
+
+Paths64 to_clipper(const polygon_type_fp& poly) {
+  Paths64 ret;
+  ret.reserve(poly.inners().size() + 1);
+  ret.push_back(to_clipper(poly.outer()));
+  for (const auto& inner : poly.inners()) {
+    ret.push_back(to_clipper(inner));
+  }
+  return ret;
+}
+
+Paths64 to_clipper(const multi_polygon_type_fp& mpoly) {
+  Paths64 ret;
+  for (const auto& poly : mpoly) {
+    for (auto& path : to_clipper(poly)) {
+      ret.push_back(std::move(path));
+    }
+  }
+  return ret;
+}
+
+static ring_type_fp from_clipper(const Path64& path) {
+  ring_type_fp ret;
+  ret.reserve(path.size() + 1);
+  for (const auto& p : path) {
+    ret.push_back(point_type_fp(p.x / CLIPPER_SCALE, p.y / CLIPPER_SCALE));
+  }
+  if (!ret.empty()) {
+    ret.push_back(ret.front());
+  }
+  return ret;
+}
+
+// The children of node are outer rings, their children are holes,
+// and the children of the holes are outer rings again.
+static void add_outers(const PolyPath64& node, multi_polygon_type_fp* mpoly) {
+  for (size_t i = 0; i < node.Count(); i++) {
+    const PolyPath64* outer = node.Child(i);
+    polygon_type_fp poly;
+    poly.outer() = from_clipper(outer->Polygon());
+    for (size_t j = 0; j < outer->Count(); j++) {
+      const PolyPath64* hole = outer->Child(j);
+      poly.inners().push_back(from_clipper(hole->Polygon()));
+      add_outers(*hole, mpoly);
+    }
+    mpoly->push_back(std::move(poly));
+  }
+}
+
+multi_polygon_type_fp from_clipper(const PolyTree64& tree) {
+  multi_polygon_type_fp ret;
+  add_outers(tree, &ret);
+  // Clipper2 has the opposite orientation from boost geometry.
+  bg::correct(ret);
+  return ret;
+}
+
+namespace clipper_helpers {
+
+static multi_polygon_type_fp execute(ClipType clip_type,
+                                     const multi_polygon_type_fp& lhs,
+                                     const multi_polygon_type_fp& rhs) {
+  Clipper64 clipper;
+  clipper.AddSubject(to_clipper(lhs));
+  clipper.AddClip(to_clipper(rhs));
+  PolyTree64 tree;
+  clipper.Execute(clip_type, FillRule::NonZero, tree);
+  return from_clipper(tree);
+}
+
+multi_polygon_type_fp union_(const multi_polygon_type_fp& lhs, const multi_polygon_type_fp& rhs) {
+  return execute(ClipType::Union, lhs, rhs);
+}
+
+multi_polygon_type_fp intersection(const multi_polygon_type_fp& lhs, const multi_polygon_type_fp& rhs) {
+  return execute(ClipType::Intersection, lhs, rhs);
+}
+
+multi_polygon_type_fp difference(const multi_polygon_type_fp& lhs, const multi_polygon_type_fp& rhs) {
+  return execute(ClipType::Difference, lhs, rhs);
+}
+
+multi_polygon_type_fp symdiff(const multi_polygon_type_fp& lhs, const multi_polygon_type_fp& rhs) {
+  return execute(ClipType::Xor, lhs, rhs);
+}
+
+multi_polygon_type_fp sum(const std::vector<multi_polygon_type_fp>& mpolys) {
+  // All the inputs have the same orientation so with NonZero a point
+  // is in the output if it's in any of them, even in the hole of one.
+  Clipper64 clipper;
+  for (const auto& mpoly : mpolys) {
+    clipper.AddSubject(to_clipper(mpoly));
+  }
+  PolyTree64 tree;
+  clipper.Execute(ClipType::Union, FillRule::NonZero, tree);
+  return from_clipper(tree);
+}
+
+multi_polygon_type_fp buffer(const multi_polygon_type_fp& mpoly, coordinate_type_fp expand_by) {
+  if (expand_by == 0 || mpoly.size() == 0) {
+    return mpoly;
+  }
+  const double delta = expand_by * CLIPPER_SCALE;
+  // The arc tolerance is how far the chords may be from the arc.
+  // This gives points_per_circle chords in a full circle.
+  const double arc_tolerance =
+      std::abs(delta) * (1 - std::cos(bg::math::pi<double>() / points_per_circle));
+  ClipperOffset offset(2.0, arc_tolerance);
+  offset.AddPaths(to_clipper(mpoly), JoinType::Round, EndType::Polygon);
+  PolyTree64 tree;
+  offset.Execute(delta, tree);
+  return from_clipper(tree);
+}
+
+} // namespace clipper_helpers
+
+#endif // USE_CLIPPER2
@@ -0,0 +1,41 @@
+#ifndef CLIPPER_HELPERS_HPP
+#define CLIPPER_HELPERS_HPP
+
+#ifdef USE_CLIPPER2
+
+#include <vector>
+
+#include <clipper2/clipper.h>
+#include "geometry.hpp"
+
+// Clipper2 works on integer coordinates so the geometry is scaled by
+// this much on the way in and back on the way out.  The coordinates
+// are in inches, so they are rounded to a grid of 1e-6in (25.4nm) and
+// each one moves by up to 12.7nm.
+constexpr double CLIPPER_SCALE = 1000000.0;
+
+Clipper2Lib::Paths64 to_clipper(const polygon_type_fp& poly);
+Clipper2Lib::Paths64 to_clipper(const multi_polygon_type_fp& mpoly);
+
+multi_polygon_type_fp from_clipper(const Clipper2Lib::PolyTree64& tree);
+
+// With --with-clipper2, the multi_polygon booleans in bg_operators,
+// including sum() and symdiff(), and the polygon buffer in bg_helpers
+// use these.  Buffering linestrings still uses geos if it's available
+// and otherwise boost geometry.
+namespace clipper_helpers {
+
+multi_polygon_type_fp union_(const multi_polygon_type_fp& lhs, const multi_polygon_type_fp& rhs);
+multi_polygon_type_fp intersection(const multi_polygon_type_fp& lhs, const multi_polygon_type_fp& rhs);
+multi_polygon_type_fp difference(const multi_polygon_type_fp& lhs, const multi_polygon_type_fp& rhs);
+multi_polygon_type_fp symdiff(const multi_polygon_type_fp& lhs, const multi_polygon_type_fp& rhs);
+// The union of all of them in one pass.
+multi_polygon_type_fp sum(const std::vector<multi_polygon_type_fp>& mpolys);
+// Round joins, with about as many points per circle as bg_helpers::buffer.
+multi_polygon_type_fp buffer(const multi_polygon_type_fp& mpoly, coordinate_type_fp expand_by);
+
+} // namespace clipper_helpers
+
+#endif // USE_CLIPPER2
+
+#endif //CLIPPER_HELPERS_HPP
@@ -0,0 +1,76 @@
+#define BOOST_TEST_MODULE clipper helpers tests
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+#include "geometry.hpp"
+#include "bg_helpers.hpp"
+#include "bg_operators.hpp"
+#include "clipper_helpers.hpp"
+
+BOOST_AUTO_TEST_SUITE(clipper_helpers_tests)
+
+static multi_polygon_type_fp square(double x, double y, double size) {
+  multi_polygon_type_fp ret;
+  bg::convert(box_type_fp(point_type_fp(x, y), point_type_fp(x + size, y + size)), ret);
+  return ret;
+}
+
+// These go through whichever backend was configured.
+BOOST_AUTO_TEST_SUITE(operators)
+
+BOOST_AUTO_TEST_CASE(booleans) {
+  const auto a = square(0, 0, 10);
+  const auto b = square(5, 5, 10);
+  BOOST_CHECK_CLOSE(bg::area(a + b), 175, 1e-6);
+  BOOST_CHECK_CLOSE(bg::area(a & b), 25, 1e-6);
+  BOOST_CHECK_CLOSE(bg::area(a - b), 75, 1e-6);
+  // Bordering squares become one.
+  BOOST_CHECK_EQUAL((a + square(10, 0, 10)).size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(sum_and_symdiff) {
+  // The third square fills the hole in the first.
+  const std::vector<multi_polygon_type_fp> mpolys{
+    square(0, 0, 10) - square(3, 3, 4), square(5, 5, 10), square(3, 3, 4)};
+  const auto all = sum(mpolys);
+  BOOST_REQUIRE_EQUAL(all.size(), 1);
+  BOOST_CHECK_EQUAL(all[0].inners().size(), 0);
+  BOOST_CHECK_CLOSE(bg::area(all), 175, 1e-6);
+  BOOST_CHECK_CLOSE(bg::area(symdiff({square(0, 0, 10), square(5, 5, 10)})), 150, 1e-6);
+}
+
+BOOST_AUTO_TEST_CASE(buffer) {
+  const auto a = square(0, 0, 10);
+  // The corners are rounded so a little less than 14*14.
+  const double grown = bg::area(bg_helpers::buffer(a, 2));
+  BOOST_CHECK_GT(grown, 100 + 4*2*10 + 0.99 * bg::math::pi<double>() * 4);
+  BOOST_CHECK_LE(grown, 100 + 4*2*10 + bg::math::pi<double>() * 4);
+  BOOST_CHECK_CLOSE(bg::area(bg_helpers::buffer(a, -2)), 36, 1e-6);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+#ifdef USE_CLIPPER2
+
+BOOST_AUTO_TEST_SUITE(clipper2)
+
+BOOST_AUTO_TEST_CASE(round_trip) {
+  auto mp = square(0, 0, 10) - square(3, 3, 4);
+  mp = mp + square(20, 20, 1.25);
+  Clipper2Lib::Clipper64 clipper;
+  clipper.AddSubject(to_clipper(mp));
+  Clipper2Lib::PolyTree64 tree;
+  clipper.Execute(Clipper2Lib::ClipType::Union, Clipper2Lib::FillRule::NonZero, tree);
+  const auto result = from_clipper(tree);
+  BOOST_REQUIRE_EQUAL(result.size(), 2);
+  BOOST_CHECK(bg::equals(result, mp));
+  // The orientation matches boost geometry.
+  BOOST_CHECK_GT(bg::area(result), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+#endif // USE_CLIPPER2
+
+BOOST_AUTO_TEST_SUITE_END()
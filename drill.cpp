@@ -40,6 +40,7 @@ using std::stringstream;
 using std::shared_ptr;
 
 #include <numeric>
+#include <chrono>
 #include <iomanip>
 using std::setprecision;
 using std::fixed;
@@ -59,6 +60,7 @@ using std::map;
 #include "units.hpp"
 #include "available_drills.hpp"
 #include "bg_operators.hpp"
+#include "profile.hpp"
 
 using std::pair;
 using std::make_pair;
@@ -82,10 +84,12 @@ ExcellonProcessor::ExcellonProcessor(const boost::program_options::variables_map
     project(parse_project(options["drill"].as<string>())),
     bMetricOutput(options["metricoutput"].as<bool>()),
     parsed_bits(parse_bits()),
-    parsed_holes(parse_holes()),
+    parsed_holes(parse_holes(parse_warnings)),
     drillfront(workSide(options, "drill")),
     inputFactor(options["metric"].as<bool>() ? 1.0/25.4 : 1),
     tsp_2opt(options["tsp-2opt"].as<bool>()),
+    tsp_2opt_neighbours(options["tsp-2opt-neighbours"].as<size_t>()),
+    tsp_time_limit(options["tsp-time-limit"].as<double>()),
     xoffset((options["zero-start"].as<bool>() ? min.x() : 0) -
             options["x-offset"].as<Length>().asInch(inputFactor)),
     yoffset((options["zero-start"].as<bool>() ? min.y() : 0) -
@@ -259,8 +263,10 @@ void ExcellonProcessor::export_ngc(const string of_dir, const boost::optional<st
                         "\nM9      (Coolant off.)\n"
                          "M2      (Program end.)\n\n");
 
-    map<int, drillbit> bits = optimize_bits();
-    const auto holes = optimize_holes(bits, onedrill, boost::none, min_milldrill_diameter);
+    const auto& bits_and_holes = get_drill_holes(onedrill);
+    const auto& bits = bits_and_holes.bits;
+    const auto& holes = bits_and_holes.holes;
+    cerr << bits_and_holes.messages;
 
     //open output file
     std::ofstream of;
@@ -572,9 +578,9 @@ void ExcellonProcessor::export_ngc(const string of_dir, const boost::optional<st
                         "\nM9      (Coolant off.)\n"
                         "M2      (Program end.)\n\n");
 
-    map<int, drillbit> bits = parsed_bits;
-    const auto holes =
-        optimize_holes(bits, false, min_milldrill_diameter, boost::none);
+    const auto& bits_and_holes = get_milldrill_holes();
+    const auto& bits = bits_and_holes.bits;
+    const auto& holes = bits_and_holes.holes;
 
     // open output file
     std::ofstream of;
@@ -745,8 +751,9 @@ map<int, drillbit> ExcellonProcessor::parse_bits() {
 }
 
 // Must be called after parse bits so that we can report on unused bits.
-map<int, multi_linestring_type_fp> ExcellonProcessor::parse_holes() {
+map<int, multi_linestring_type_fp> ExcellonProcessor::parse_holes(string& warnings) {
   map<int, multi_linestring_type_fp> holes;
+  stringstream warnings_stream;
 
   for (gerbv_net_t* currentNet = project->file[0]->image->netlist; currentNet;
        currentNet = currentNet->next) {
@@ -758,14 +765,15 @@ map<int, multi_linestring_type_fp> ExcellonProcessor::parse_holes() {
   // Report all bits that are unused as warnings.
   for (const auto& bit : parsed_bits) {
     if (holes.count(bit.first) == 0) { //If a bit has no associated holes
-      cerr << "Warning: bit " << bit.first << " ("
-           << drill_to_string(bit.second) << ") has no associated holes; "
+      warnings_stream << "Warning: bit " << bit.first << " ("
+                      << drill_to_string(bit.second) << ") has no associated holes; "
           "removing it." << std::endl;
       // We don't really remove the bit.  If there are no holes
       // associated, we'll remove the hole later and there will be no
       // output for the bit.
     }
   }
+  warnings = warnings_stream.str();
   return holes;
 }
 
@@ -831,10 +839,17 @@ vector<pair<int, multi_linestring_type_fp>> ExcellonProcessor::optimize_holes(
 
   //Optimize the holes path
   for (auto& path : holes) {
+    profile::Timer timer("tsp");
+    profile::count("tsp", "holes", path.second.size());
     if (tsp_2opt) {
-      tsp_solver::tsp_2opt(path.second, point_type_fp(get_xvalue(0) + xoffset, get_yvalue(0) + yoffset));
+      tsp_solver::tsp_2opt(path.second, point_type_fp(get_xvalue(0) + xoffset, get_yvalue(0) + yoffset),
+                           tsp_2opt_neighbours).count("tsp", "2opt");
     } else {
-      tsp_solver::nearest_neighbour(path.second, point_type_fp(get_xvalue(0) + xoffset, get_yvalue(0) + yoffset));
+      tsp_solver::nearest_neighbour_kd_tree(path.second, point_type_fp(get_xvalue(0) + xoffset, get_yvalue(0) + yoffset));
+    }
+    if (tsp_time_limit > 0) {
+      tsp_solver::tsp_improve(path.second, point_type_fp(get_xvalue(0) + xoffset, get_yvalue(0) + yoffset),
+                              std::chrono::duration<double>(tsp_time_limit)).count("tsp", "improve");
     }
   }
 
@@ -854,7 +869,7 @@ vector<pair<int, multi_linestring_type_fp>> ExcellonProcessor::optimize_holes(
 /*
  */
 /******************************************************************************/
-map<int, drillbit> ExcellonProcessor::optimize_bits() {
+map<int, drillbit> ExcellonProcessor::optimize_bits(std::ostream& messages) {
   map<int, drillbit> bits(parsed_bits);
   // If there is a list of available bits, round the holes to the nearest
   // available bit.
@@ -880,9 +895,9 @@ map<int, drillbit> ExcellonProcessor::optimize_bits() {
         wanted_drill_bit.diameter = best_available_drill->diameter().asInch(inputFactor);
         wanted_drill_bit.unit = "inch";
         if (abs(*difference) > 1e-6) {
-          cerr << "Info: bit " << wanted_drill.first << " ("
-               << old_string << ") is rounded to "
-               << drill_to_string(wanted_drill_bit) << std::endl;
+          messages << "Info: bit " << wanted_drill.first << " ("
+                   << old_string << ") is rounded to "
+                   << drill_to_string(wanted_drill_bit) << std::endl;
         }
       }
     }
@@ -890,6 +905,35 @@ map<int, drillbit> ExcellonProcessor::optimize_bits() {
   return bits;
 }
 
+void ExcellonProcessor::optimize(bool onedrill) {
+  get_milldrill_holes();
+  get_drill_holes(onedrill);
+}
+
+void ExcellonProcessor::print_parse_warnings() const {
+  cerr << parse_warnings;
+}
+
+const ExcellonProcessor::bits_and_holes_t& ExcellonProcessor::get_drill_holes(bool onedrill) {
+  auto found = drill_holes.find(onedrill);
+  if (found != drill_holes.cend()) {
+    return found->second;
+  }
+  stringstream messages;
+  map<int, drillbit> bits = optimize_bits(messages);
+  auto holes = optimize_holes(bits, onedrill, boost::none, min_milldrill_diameter);
+  return drill_holes.emplace(onedrill, bits_and_holes_t{bits, holes, messages.str()}).first->second;
+}
+
+const ExcellonProcessor::bits_and_holes_t& ExcellonProcessor::get_milldrill_holes() {
+  if (!milldrill_holes) {
+    map<int, drillbit> bits = parsed_bits;
+    auto holes = optimize_holes(bits, false, min_milldrill_diameter, boost::none);
+    milldrill_holes = bits_and_holes_t{bits, holes, ""};
+  }
+  return *milldrill_holes;
+}
+
 /******************************************************************************/
 /*
  */
@@ -27,6 +27,7 @@
 #include <string>
 #include <list>
 #include <vector>
+#include <ostream>
 #include <memory>
 
 extern "C" {
@@ -88,6 +89,15 @@ public:
     void export_ngc(const std::string of_dir, const boost::optional<std::string>& of_name,
                     std::shared_ptr<Cutter> target, bool zchange_absolute);
 
+    // Find the order of the holes for drilling and milldrilling.  This
+    // is the slow part of the processing and it doesn't write any
+    // output so it can be done ahead of time, while other work is
+    // happening.  export_ngc will reuse the results.
+    void optimize(bool onedrill);
+    // Print the warnings from reading the drill file.  They are kept
+    // until now so that the file can be read on another thread.
+    void print_parse_warnings() const;
+
     std::shared_ptr< std::map<int, drillbit> > get_bits();
     std::shared_ptr< std::map<int, multi_linestring_type_fp> > get_holes();
 
@@ -97,7 +107,7 @@ private:
   };
   std::unique_ptr<gerbv_project_t, GerbvDeleter> parse_project(const std::string& filename);
   std::map<int, drillbit> parse_bits();
-  std::map<int, multi_linestring_type_fp> parse_holes();
+  std::map<int, multi_linestring_type_fp> parse_holes(std::string& warnings);
 
     bool millhole(std::ofstream &of,
                   double start_x, double start_y,
@@ -111,7 +121,15 @@ private:
       std::map<int, drillbit>& bits, bool onedrill,
       const boost::optional<Length>& min_diameter,
       const boost::optional<Length>& max_diameter);
-  std::map<int, drillbit> optimize_bits();
+  std::map<int, drillbit> optimize_bits(std::ostream& messages);
+  struct bits_and_holes_t {
+    std::map<int, drillbit> bits;
+    std::vector<std::pair<int, multi_linestring_type_fp>> holes;
+    // Printed when the holes are exported, like the rest of the output.
+    std::string messages;
+  };
+  const bits_and_holes_t& get_drill_holes(bool onedrill);
+  const bits_and_holes_t& get_milldrill_holes();
 
     void save_svg(
         const std::map<int, drillbit>& bits,
@@ -123,6 +141,7 @@ private:
 
     std::unique_ptr<gerbv_project_t, GerbvDeleter> const project;
     const bool bMetricOutput;   //Flag to indicate metric output
+    std::string parse_warnings;  // Printed by print_parse_warnings.
     const std::map<int, drillbit> parsed_bits;
     const std::map<int, multi_linestring_type_fp> parsed_holes;
     std::vector<std::string> header;
@@ -135,6 +154,8 @@ private:
     const bool drillfront;
     const double inputFactor;   //Multiply unitless inputs by this value.
     const bool tsp_2opt;        // Perform TSP 2opt optimization on drill path.
+    const size_t tsp_2opt_neighbours; // If not 0, only try 2opt moves among this many nearest neighbours.
+    const double tsp_time_limit; // Seconds to spend improving the drill path after 2opt.
     const double xoffset;
     const double yoffset;
     const Length mirror_axis;
@@ -147,6 +168,9 @@ private:
     uniqueCodes globalVars;
     const Tiling::TileInfo tileInfo;
     std::unique_ptr<Tiling> tiling;
+    // Memoized optimized holes.  The drill ones are keyed by onedrill.
+    std::map<bool, bits_and_holes_t> drill_holes;
+    boost::optional<bits_and_holes_t> milldrill_holes;
 };
 
 #endif // DRILL_H
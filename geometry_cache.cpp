@@ -0,0 +1,185 @@
+#include "geometry_cache.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+#include "config.h"
+#include "common.hpp"
+
+namespace geometry_cache {
+
+using std::string;
+
+namespace {
+
+// Increment this when the format of any entry changes.
+const uint32_t format_version = 1;
+
+// The start of every entry.  The byte order marker means that
+// entries from machines with another byte order are ignored.  The
+// version means that entries from another build of pcb2gcode are
+// ignored because the geometry might be different.
+string header() {
+  string result = "pcb2gcode cache\n";
+  write(result, uint32_t(0x01020304));
+  write(result, format_version);
+  string version = PACKAGE_VERSION;
+#ifdef GIT_VERSION
+  version += " " GIT_VERSION;
+#endif
+  write(result, uint64_t(version.size()));
+  result += version;
+  return result;
+}
+
+string entry_filename(const string& directory, const string& kind, const string& key) {
+  return build_filename(directory, kind + "-" + key + ".bin");
+}
+
+} // namespace
+
+Hash& Hash::add(const void* data, size_t size) {
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  for (size_t i = 0; i < size; i++) {
+    value ^= bytes[i];
+    value *= 1099511628211ULL;
+  }
+  return *this;
+}
+
+Hash& Hash::add(const string& s) {
+  // The size is added so that ("ab", "c") and ("a", "bc") differ.
+  add(uint64_t(s.size()));
+  return add(s.data(), s.size());
+}
+
+bool Hash::add_file(const string& path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return false;
+  }
+  std::ostringstream contents;
+  contents << file.rdbuf();
+  add(contents.str());
+  return !file.bad();
+}
+
+string Hash::hex() const {
+  char buffer[17];
+  std::snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(value));
+  return buffer;
+}
+
+void write(string& out, const string& s) {
+  write(out, uint64_t(s.size()));
+  out += s;
+}
+
+void write(string& out, const point_type_fp& p) {
+  write(out, p.x());
+  write(out, p.y());
+}
+
+void write(string& out, const polygon_type_fp& p) {
+  write(out, p.outer());
+  write(out, p.inners());
+}
+
+bool Reader::read(string& s) {
+  size_t size;
+  if (!read_size(size)) {
+    return false;
+  }
+  s = data.substr(position, size);
+  position += size;
+  return true;
+}
+
+bool Reader::read(point_type_fp& p) {
+  coordinate_type_fp x;
+  coordinate_type_fp y;
+  if (!read(x) || !read(y)) {
+    return false;
+  }
+  p = point_type_fp(x, y);
+  return true;
+}
+
+bool Reader::read(polygon_type_fp& p) {
+  return read(p.outer()) && read(p.inners());
+}
+
+bool Reader::read_size(size_t& size) {
+  uint64_t value;
+  if (!read(value) || value > data.size() - position) {
+    return false;
+  }
+  size = value;
+  return true;
+}
+
+bool load_entry(const string& directory, const string& kind, const string& key, string& data) {
+  std::ifstream file(entry_filename(directory, kind, key), std::ios::binary);
+  if (!file) {
+    return false;
+  }
+  std::ostringstream contents;
+  contents << file.rdbuf();
+  if (file.bad()) {
+    return false;
+  }
+  data = contents.str();
+  const string expected_header = header();
+  if (data.compare(0, expected_header.size(), expected_header) != 0) {
+    return false;
+  }
+  data.erase(0, expected_header.size());
+  return true;
+}
+
+bool store_entry(const string& directory, const string& kind, const string& key, const string& data) {
+  const string filename = entry_filename(directory, kind, key);
+  // Write to a temporary file first so that a concurrent run never
+  // reads a partial entry.  The name is unique to the process and the
+  // thread so that no two writers share one.
+  std::ostringstream temp_filename;
+  temp_filename << filename << ".tmp" << getpid() << "."
+                << std::hash<std::thread::id>()(std::this_thread::get_id());
+  bool ok;
+  {
+    std::ofstream file(temp_filename.str(), std::ios::binary);
+    const string h = header();
+    file.write(h.data(), h.size());
+    file.write(data.data(), data.size());
+    ok = bool(file);
+  }
+  if (ok) {
+    ok = std::rename(temp_filename.str().c_str(), filename.c_str()) == 0;
+    if (!ok) {
+      // Windows won't rename over an existing file.
+      std::remove(filename.c_str());
+      ok = std::rename(temp_filename.str().c_str(), filename.c_str()) == 0;
+    }
+  }
+  if (!ok) {
+    std::remove(temp_filename.str().c_str());
+    static std::atomic<bool> warned(false);
+    if (!warned.exchange(true)) {
+      std::cerr << "Warning: Can't write to the cache in " << directory << "\n";
+    }
+  }
+  return ok;
+}
+
+} // namespace geometry_cache
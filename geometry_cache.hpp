@@ -0,0 +1,189 @@
+#ifndef GEOMETRY_CACHE_HPP
+#define GEOMETRY_CACHE_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "geometry.hpp"
+
+// A cache of geometry on disk, so that work that was done in an
+// earlier run with the same inputs can be skipped.  Each entry is a
+// file in the cache directory named by a hash of everything that
+// affects its contents.  The values are stored in the native binary
+// format of the machine so they come back exactly as they were
+// stored.  Entries made by another machine, another version of
+// pcb2gcode or that are damaged are ignored.
+namespace geometry_cache {
+
+// A 64-bit FNV-1a hash of the inputs of a cache entry.
+class Hash {
+ public:
+  Hash& add(const void* data, size_t size);
+  Hash& add(const std::string& s);
+  template <typename T>
+  typename std::enable_if<std::is_arithmetic<T>::value, Hash&>::type add(T value) {
+    return add(&value, sizeof(value));
+  }
+  // Adds the contents of the file.  Returns false if it can't be read.
+  bool add_file(const std::string& path);
+  std::string hex() const;
+
+ private:
+  uint64_t value = 14695981039346656037ULL;
+};
+
+// Serialization of the geometry types into a string of bytes.
+template <typename T>
+typename std::enable_if<std::is_arithmetic<T>::value>::type write(std::string& out, T value) {
+  out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+void write(std::string& out, const std::string& s);
+void write(std::string& out, const point_type_fp& p);
+void write(std::string& out, const polygon_type_fp& p);
+template <typename T, typename A>
+void write(std::string& out, const std::vector<T, A>& v);
+template <typename K, typename V>
+void write(std::string& out, const std::map<K, V>& m);
+template <typename A, typename B>
+void write(std::string& out, const std::pair<A, B>& p);
+
+template <typename T, typename A>
+void write(std::string& out, const std::vector<T, A>& v) {
+  write(out, uint64_t(v.size()));
+  for (const auto& x : v) {
+    write(out, x);
+  }
+}
+
+template <typename K, typename V>
+void write(std::string& out, const std::map<K, V>& m) {
+  write(out, uint64_t(m.size()));
+  for (const auto& x : m) {
+    write(out, x);
+  }
+}
+
+template <typename A, typename B>
+void write(std::string& out, const std::pair<A, B>& p) {
+  write(out, p.first);
+  write(out, p.second);
+}
+
+// Reads what write wrote.  Each read returns false if the data is
+// too short.
+class Reader {
+ public:
+  explicit Reader(const std::string& data) : data(data) {}
+
+  template <typename T>
+  typename std::enable_if<std::is_arithmetic<T>::value, bool>::type read(T& value) {
+    if (data.size() - position < sizeof(value)) {
+      return false;
+    }
+    std::memcpy(&value, data.data() + position, sizeof(value));
+    position += sizeof(value);
+    return true;
+  }
+  bool read(std::string& s);
+  bool read(point_type_fp& p);
+  bool read(polygon_type_fp& p);
+  template <typename T, typename A>
+  bool read(std::vector<T, A>& v);
+  template <typename K, typename V>
+  bool read(std::map<K, V>& m);
+  template <typename A, typename B>
+  bool read(std::pair<A, B>& p);
+
+  bool at_end() const { return position == data.size(); }
+
+ private:
+  // Reads a count of elements and checks that it's not more than
+  // there are bytes left, which would only be in damaged data.
+  bool read_size(size_t& size);
+
+  const std::string& data;
+  size_t position = 0;
+};
+
+template <typename T, typename A>
+bool Reader::read(std::vector<T, A>& v) {
+  size_t size;
+  if (!read_size(size)) {
+    return false;
+  }
+  v.resize(size);
+  for (auto& x : v) {
+    if (!read(x)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <typename K, typename V>
+bool Reader::read(std::map<K, V>& m) {
+  size_t size;
+  if (!read_size(size)) {
+    return false;
+  }
+  m.clear();
+  for (size_t i = 0; i < size; i++) {
+    std::pair<K, V> x;
+    if (!read(x)) {
+      return false;
+    }
+    m.insert(std::move(x));
+  }
+  return true;
+}
+
+template <typename A, typename B>
+bool Reader::read(std::pair<A, B>& p) {
+  return read(p.first) && read(p.second);
+}
+
+// Read the whole entry into data.  Returns false if there is no
+// valid entry for the key.
+bool load_entry(const std::string& directory, const std::string& kind,
+                const std::string& key, std::string& data);
+// Write data as the entry for the key.  Returns false if it couldn't
+// be written.  The entry is replaced atomically where the platform
+// allows it so that concurrent runs never see a partial entry.
+bool store_entry(const std::string& directory, const std::string& kind,
+                 const std::string& key, const std::string& data);
+
+// Load the values stored for the key.  Returns false and leaves the
+// values in an unspecified state if there is no valid entry.
+template <typename... T>
+bool load(const std::string& directory, const std::string& kind, const std::string& key,
+          T&... values) {
+  std::string data;
+  if (!load_entry(directory, kind, key, data)) {
+    return false;
+  }
+  Reader reader(data);
+  bool ok = true;
+  (void) std::initializer_list<int>{(ok = ok && reader.read(values), 0)...};
+  return ok && reader.at_end();
+}
+
+// Store the values for the key.  Failures are reported on stderr
+// once and otherwise ignored because the cache is only an
+// optimization.
+template <typename... T>
+void store(const std::string& directory, const std::string& kind, const std::string& key,
+           const T&... values) {
+  std::string data;
+  (void) std::initializer_list<int>{(write(data, values), 0)...};
+  store_entry(directory, kind, key, data);
+}
+
+} // namespace geometry_cache
+
+#endif // GEOMETRY_CACHE_HPP
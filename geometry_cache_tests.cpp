@@ -0,0 +1,110 @@
+#define BOOST_TEST_MODULE geometry cache tests
+#include <boost/test/unit_test.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "geometry.hpp"
+#include "geometry_cache.hpp"
+
+using std::map;
+using std::pair;
+using std::string;
+using std::vector;
+
+BOOST_AUTO_TEST_SUITE(geometry_cache_tests)
+
+BOOST_AUTO_TEST_CASE(hash) {
+  using geometry_cache::Hash;
+  BOOST_CHECK_EQUAL(Hash().hex(), "cbf29ce484222325");
+  BOOST_CHECK_EQUAL(Hash().add("a", 1).hex(), "af63dc4c8601ec8c");
+  BOOST_CHECK_NE(Hash().add(string("ab")).add(string("c")).hex(),
+                 Hash().add(string("a")).add(string("bc")).hex());
+  BOOST_CHECK_NE(Hash().add(1.0).hex(), Hash().add(2.0).hex());
+  BOOST_CHECK(!Hash().add_file("file_that_does_not_exist"));
+}
+
+BOOST_AUTO_TEST_CASE(round_trip) {
+  multi_polygon_type_fp mp{{{{0, 0}, {0, 10}, {10, 10}, {10, 0}, {0, 0}},
+                            {{{2, 2}, {4, 2}, {4, 4}, {2, 4}, {2, 2}}}},
+                           {{{20, 20}, {20, 30}, {30, 30}, {20, 20}}}};
+  map<coordinate_type_fp, multi_linestring_type_fp> lines{
+    {0.1, {{{0, 0}, {1.0 / 3, 2}}, {{5, 5}, {6, 6}, {7, 5}}}},
+    {0.25, {}}};
+  string data;
+  geometry_cache::write(data, true);
+  geometry_cache::write(data, mp);
+  geometry_cache::write(data, lines);
+
+  geometry_cache::Reader reader(data);
+  bool b = false;
+  multi_polygon_type_fp mp2;
+  map<coordinate_type_fp, multi_linestring_type_fp> lines2;
+  BOOST_CHECK(reader.read(b));
+  BOOST_CHECK(reader.read(mp2));
+  BOOST_CHECK(reader.read(lines2));
+  BOOST_CHECK(reader.at_end());
+  BOOST_CHECK(b);
+  // Writing again gives exactly the same bytes.
+  string data2;
+  geometry_cache::write(data2, b);
+  geometry_cache::write(data2, mp2);
+  geometry_cache::write(data2, lines2);
+  BOOST_CHECK(data2 == data);
+  BOOST_CHECK(bg::equals(mp2, mp));
+  BOOST_REQUIRE_EQUAL(lines2.size(), 2);
+  BOOST_CHECK(lines2[0.25].empty());
+
+  // Truncated data fails to read.
+  const string truncated = data.substr(0, data.size() - 1);
+  geometry_cache::Reader truncated_reader(truncated);
+  BOOST_CHECK(truncated_reader.read(b));
+  BOOST_CHECK(truncated_reader.read(mp2));
+  BOOST_CHECK(!truncated_reader.read(lines2));
+}
+
+BOOST_AUTO_TEST_CASE(store_and_load) {
+  const string key = geometry_cache::Hash().add(string("store_and_load")).hex();
+  multi_polygon_type_fp mp{{{{0, 0}, {0, 10}, {10, 10}, {10, 0}, {0, 0}}}};
+  multi_polygon_type_fp loaded;
+  double d = 0;
+  BOOST_CHECK(!geometry_cache::load(".", "test", "missing", loaded));
+  geometry_cache::store(".", "test", key, mp, 3.5);
+  BOOST_CHECK(geometry_cache::load(".", "test", key, loaded, d));
+  BOOST_CHECK(bg::equals(loaded, mp));
+  BOOST_CHECK_EQUAL(d, 3.5);
+  // The wrong types don't load.
+  BOOST_CHECK(!geometry_cache::load(".", "test", key, loaded));
+  BOOST_CHECK(!geometry_cache::load(".", "test", key, loaded, d, d));
+
+  // Toolpaths and the svg files that go with them.
+  const string toolpath_key = geometry_cache::Hash().add(string("toolpaths")).hex();
+  vector<pair<coordinate_type_fp, multi_linestring_type_fp>> toolpaths{
+    {0.1, {{{0, 0}, {1, 2}}}}, {0.2, {}}};
+  vector<pair<string, string>> svgs{{"traced_front.svg", string("<svg>\0</svg>", 14)}};
+  vector<pair<coordinate_type_fp, multi_linestring_type_fp>> loaded_toolpaths;
+  vector<pair<string, string>> loaded_svgs;
+  geometry_cache::store(".", "test", toolpath_key, toolpaths, svgs);
+  BOOST_CHECK(geometry_cache::load(".", "test", toolpath_key, loaded_toolpaths, loaded_svgs));
+  BOOST_REQUIRE_EQUAL(loaded_toolpaths.size(), 2);
+  BOOST_CHECK_EQUAL(loaded_toolpaths[0].first, 0.1);
+  BOOST_CHECK(bg::equals(loaded_toolpaths[0].second, toolpaths[0].second));
+  BOOST_CHECK(loaded_toolpaths[1].second.empty());
+  BOOST_CHECK(loaded_svgs == svgs);
+  std::remove(("./test-" + toolpath_key + ".bin").c_str());
+
+  const string filename = "./test-" + key + ".bin";
+  {
+    // Damage the header.
+    std::fstream file(filename, std::ios::in | std::ios::out | std::ios::binary);
+    file.put('P');
+  }
+  BOOST_CHECK(!geometry_cache::load(".", "test", key, loaded, d));
+  std::remove(filename.c_str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -79,17 +79,25 @@ multi_linestring_type_fp from_geos(const std::unique_ptr<geos::geom::MultiLineSt
 }
 
 template <>
-multi_polygon_type_fp from_geos(const std::unique_ptr<geos::geom::Geometry>& g) {
-  if (dynamic_cast<geos::geom::MultiPolygon*>(g.get())) {
-    auto mp = boost::dynamic_pointer_cast<geos::geom::MultiPolygon>(g->clone());
-    return from_geos(mp);
+multi_polygon_type_fp from_geos(const geos::geom::Geometry* g) {
+  if (auto mpoly = dynamic_cast<const geos::geom::MultiPolygon*>(g)) {
+    multi_polygon_type_fp ret;
+    ret.reserve(mpoly->getNumGeometries());
+    for (size_t i = 0; i < mpoly->getNumGeometries(); i++) {
+      ret.push_back(from_geos(mpoly->getGeometryN(i)));
+    }
+    return ret;
   }
-  if (dynamic_cast<geos::geom::Polygon*>(g.get())) {
-  auto p = boost::dynamic_pointer_cast<geos::geom::Polygon>(g->clone());
-    return multi_polygon_type_fp{from_geos(p)};
+  if (auto poly = dynamic_cast<const geos::geom::Polygon*>(g)) {
+    return multi_polygon_type_fp{from_geos(poly)};
   }
   geos::io::WKTWriter writer;
-  throw std::logic_error("Can't convert to multi_polygon_type_fp: " + writer.write(g.get()));
+  throw std::logic_error("Can't convert to multi_polygon_type_fp: " + writer.write(g));
+}
+
+template <>
+multi_polygon_type_fp from_geos(const std::unique_ptr<geos::geom::Geometry>& g) {
+  return from_geos<multi_polygon_type_fp>(g.get());
 }
 
 std::unique_ptr<geos::geom::LineString> to_geos(
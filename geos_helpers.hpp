@@ -18,6 +18,8 @@ std::unique_ptr<geos::geom::Polygon> to_geos(const polygon_type_fp& poly);
 std::unique_ptr<geos::geom::MultiPolygon> to_geos(const multi_polygon_type_fp& mpoly);
 std::unique_ptr<geos::geom::MultiLineString> to_geos(const multi_linestring_type_fp& mls);
 
+template <typename T>
+T from_geos(const geos::geom::Geometry* g);
 template <typename T>
 T from_geos(const std::unique_ptr<geos::geom::Geometry>& g);
 
@@ -4,6 +4,7 @@
 #include "geometry.hpp"
 #include "geos_helpers.hpp"
 #include "bg_operators.hpp"
+#include "bg_helpers.hpp"
 #ifdef GEOS_VERSION
 #include <geos/io/WKTReader.h>
 #endif // GEOS_VERSION
@@ -32,6 +33,48 @@ BOOST_AUTO_TEST_CASE(polygon_with_holes_direction) {
   BOOST_CHECK_EQUAL(mpoly[0].inners()[0][1], point_type_fp(7,3));
 }
 
+// The lazy conversions give the same results as converting every time.
+BOOST_AUTO_TEST_CASE(lazy_multi_polygon) {
+  using bg_helpers::LazyMultiPolygon;
+  multi_polygon_type_fp a;
+  bg::convert(box_type_fp(point_type_fp(0,0), point_type_fp(10,10)), a);
+  multi_polygon_type_fp b;
+  bg::convert(box_type_fp(point_type_fp(5,5), point_type_fp(15,15)), b);
+  const LazyMultiPolygon lazy_a(a);
+  const LazyMultiPolygon lazy_b(b);
+
+  const auto expected = ((bg_helpers::buffer(a, 1) + b) & a) - bg_helpers::buffer(b, -2);
+  const auto actual = ((lazy_a.buffer(1) + lazy_b) & lazy_a) - lazy_b.buffer(-2);
+  BOOST_CHECK(bg::equals(actual.get(), expected));
+
+  // Empty operands and zero buffers give back the other side.
+  const LazyMultiPolygon empty;
+  BOOST_CHECK(bg::equals((lazy_a.buffer(2) + empty).get(), bg_helpers::buffer(a, 2)));
+  BOOST_CHECK(bg::equals((empty + lazy_a).get(), a));
+  BOOST_CHECK(bg::equals(lazy_a.buffer(0).get(), a));
+  BOOST_CHECK(empty.buffer(1).get().empty());
+  // With geos, a buffer that vanishes is an empty geos geometry that
+  // is only converted if it's needed.
+  const auto vanished = lazy_a.buffer(-6);
+  BOOST_CHECK_EQUAL(bg::area(vanished.get()), 0);
+  BOOST_CHECK(bg::equals((lazy_a.buffer(-6) + lazy_b).get(), b));
+  BOOST_CHECK(bg::equals((lazy_b + lazy_a.buffer(-6)).get(), b));
+  BOOST_CHECK_EQUAL(bg::area(lazy_a.buffer(-6).buffer(1).get()), 0);
+  BOOST_CHECK((lazy_a & empty).get().empty());
+  BOOST_CHECK((lazy_a.buffer(-6) & lazy_b).get().empty());
+  BOOST_CHECK(bg::equals((lazy_a - lazy_a.buffer(-6)).get(), a));
+  BOOST_CHECK(bg::equals((lazy_a.buffer(1) - lazy_b).get(), bg_helpers::buffer(a, 1) - b));
+  // Shapes that only touch have no intersection, not a line.
+  multi_polygon_type_fp c;
+  bg::convert(box_type_fp(point_type_fp(10,0), point_type_fp(20,10)), c);
+  BOOST_CHECK((lazy_a & LazyMultiPolygon(c)).get().empty());
+  BOOST_CHECK(bg::equals((lazy_a.buffer(1) & LazyMultiPolygon(c)).get(), bg_helpers::buffer(a, 1) & c));
+
+  bg_helpers::MultiBuffer buffers(a);
+  BOOST_CHECK_EQUAL(&buffers(1), &buffers(1));
+  BOOST_CHECK(bg::equals(buffers(1).get(), bg_helpers::buffer(a, 1)));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 #ifdef GEOS_VERSION
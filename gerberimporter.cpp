@@ -56,6 +56,7 @@ using std::map;
 #include "bg_operators.hpp"
 #include "bg_helpers.hpp"
 #include "merge_near_points.hpp"
+#include "profile.hpp"
 
 namespace bg = boost::geometry;
 
@@ -72,6 +73,7 @@ GerberImporter::~GerberImporter() {
 
 /* Returns true iff successful. */
 bool GerberImporter::load_file(const string& path) {
+  this->path = path;
   gchar *filename = g_strdup(path.c_str());
   gerbv_open_layer_from_filename(project, filename);
   g_free(filename);
@@ -736,6 +738,7 @@ pair<multi_polygon_type_fp, map<coordinate_type_fp, multi_linestring_type_fp>> G
     bool fill_closed_lines,
     bool render_paths_to_shapes,
     unsigned int points_per_circle) const {
+  profile::Timer timer("GerberImporter::render");
   ring_type_fp region;
   bool contour = false; // Are we in contour mode?
 
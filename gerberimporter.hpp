@@ -63,12 +63,17 @@ public:
   const gerbv_project_t* get_project() const {
     return project;
   }
+  // The path given to load_file.
+  const std::string& get_path() const {
+    return path;
+  }
 
 protected:
   enum Side { FRONT = 0, BACK = 1 } side;
 
 private:
   gerbv_project_t* project;
+  std::string path;
 };
 
 #endif // GERBERIMPORTER_H
@@ -4,7 +4,6 @@
 
 from __future__ import print_function
 import argparse
-import collections
 import difflib
 import filecmp
 import multiprocessing
@@ -23,159 +22,7 @@ import unittest
 
 from concurrencytest import ConcurrentTestSuite, fork_for_tests
 
-TestCase = collections.namedtuple("TestCase", ["name", "input_path", "args", "exit_code"])
-
-EXAMPLES_PATH = "testing/gerbv_example"
-BROKEN_EXAMPLES_PATH = "testing/broken_examples"
-TEST_CASES = ([TestCase(x, os.path.join(EXAMPLES_PATH, x), [], 0)
-              for x in [
-                  "am-test",
-                  "am-test-counterclockwise",
-                  "am-test-extended",
-                  "am-test-millinfeed",
-                  "am-test-voronoi",
-                  "am-test-voronoi-extra-passes",
-                  "am-test-voronoi-front",
-                  "am-test-voronoi-wide-extra-passes",
-                  "backtrack",
-                  "backtrack_0",
-                  "D1MiniGSR",
-                  "Easy-SDR_HF_Upconverter_SMD_Gerbers",
-                  "edge-cuts-broken-loop",
-                  "edge-cuts-inside-cuts",
-                  "example_board_new_default",
-                  "example_board_new_mirror_x",
-                  "example_board_new_mirror_y",
-                  "example_board_new_mirror_y_drill_back",
-                  "example_board_new_zero_start",
-                  "example_board_al_custom",
-                  "example_board_al_custom_tiled",
-                  "example_board_al_linuxcnc",
-                  "example_board_al_linuxcnc_tiled",
-                  "example_board_al_mach3",
-                  "example_board_al_mach3_tiled",
-                  "example_board_al_mach4",
-                  "example_board_al_mach4_tiled",
-                  "invert_gerbers",
-                  "invert_gerbers_fill",
-                  "KeyboardControllerM102",
-                  "KNoT-Gateway Mini Starter Board",
-                  "KNoT_Thing_Starter_Board",
-                  "lift-mill",
-                  "mill_masking",
-                  "mill_masking_voronoi",
-                  "milldrilldiatest",
-                  "milldrilldiatest_units",
-                  "multivibrator",
-                  "multivibrator-basename",
-                  "multivibrator-clockwise",
-                  "multivibrator-contentions",
-                  "multivibrator-extra-passes",
-                  "multivibrator-extra-passes-big",
-                  "multivibrator-extra-passes-two-isolators",
-                  "multivibrator-extra-passes-two-isolators-tiles",
-                  "multivibrator-extra-passes-two-isolators-tiles-al",
-                  "multivibrator-extra-passes-voronoi",
-                  "multivibrator-identical-isolators",
-                  "multivibrator-no-tsp-2opt",
-                  "multivibrator-no-zbridges",
-                  "multivibrator-two-isolators",
-                  "multivibrator_backtrack",
-                  "multivibrator_no_export",
-                  "multivibrator_no_export_milldrill",
-                  "multivibrator_no_optimise",
-                  "multivibrator_no_zero_start",
-                  "multivibrator_nom6",
-                  "multivibrator_pre_post_milling_gcode",
-                  "multivibrator_xy_offset",
-                  "multivibrator_xy_offset_zero_start",
-                  "multivibrator-zchange-absolute",
-                  "multi_outline",
-                  "null_drill",
-                  "overlapping_edge_cuts",
-                  "project-controller",
-                  "Rotary-Encoder-Breakout",
-                  "round_pcb_3",
-                  "round_pcb_4",
-                  "round_pcb_5",
-                  "shaped_pcb",
-                  "sharp_corner",
-                  "sharp_corner_2",
-                  "sharp_corner_2_offset",
-                  "sharp_corner_big_isolation_width",
-                  "silk",
-                  "silk-lines",
-                  "slots-milldrill",
-                  "slots-milldrill-metric",
-                  "slots-with-drill",
-                  "slots-with-drill-and-milldrill",
-                  "slots-with-drill-metric",
-                  "slots-with-drills-available",
-              ]] +
-              [TestCase("split config csv", os.path.join(BROKEN_EXAMPLES_PATH, "split_config"),
-                        ["--config=millproject,millproject2"], 0)] +
-              [TestCase("bad output dir " + x, os.path.join(EXAMPLES_PATH, x),
-                        ["--output-dir=/tmp/nonexistantpath"], 1)
-               for x in ("multivibrator", "slots-with-drill", "slots-milldrill")] +
-              [TestCase("split config", os.path.join(BROKEN_EXAMPLES_PATH, "split_config"),
-                        ["--config=millproject", "--config=millproject2"], 0)] +
-              [TestCase("split config", os.path.join(BROKEN_EXAMPLES_PATH, "split_config"),
-                        [], 14)] +
-              [TestCase("multivibrator_bad_" + x,
-                        os.path.join(EXAMPLES_PATH, "multivibrator"),
-                        ["--" + x + "=non_existant_file"], 100)
-               for x in ("front", "back", "outline", "drill")] +
-              [TestCase("broken_" + x,
-                        os.path.join(BROKEN_EXAMPLES_PATH, x),
-                        [], 100)
-               for x in ("invalid-config",
-                         )
-              ] +
-              [TestCase("version",
-                        os.path.join(EXAMPLES_PATH),
-                        ["--version"],
-                        0)] +
-              [TestCase("help",
-                        os.path.join(EXAMPLES_PATH),
-                        ["--help"],
-                        0)] +
-              [TestCase("tsp_2opt_with_millfeedirection",
-                        os.path.join(EXAMPLES_PATH, "am-test"),
-                        ["--tsp-2opt", "--mill-feed-direction=climb"],
-                        100)] +
-              [TestCase("g64_and_tolerance",
-                        os.path.join(EXAMPLES_PATH, "am-test"),
-                        ["--g64=5", "--tolerance=123"],
-                        49)] +
-              [TestCase("negative_spinup",
-                        os.path.join(EXAMPLES_PATH, "am-test"),
-                        ["--spinup-time=-5"],
-                        52)] +
-              [TestCase("zero_millinfeed",
-                        os.path.join(EXAMPLES_PATH, "am-test"),
-                        ["--mill-infeed=0"],
-                        55)] +
-              [TestCase("ignore warnings",
-                        os.path.join(BROKEN_EXAMPLES_PATH, "invalid-config"),
-                        ["--ignore-warnings"],
-                        0)] +
-              [TestCase("provided config",
-                        os.path.join(EXAMPLES_PATH, "am-test"),
-                        ["--config=millproject"],
-                        0)] +
-              [TestCase("missing config",
-                        os.path.join(EXAMPLES_PATH, "am-test"),
-                        ["--config=millproject_file_does_not_exist"],
-                        100)] +
-              [TestCase("invalid_millfeedirection",
-                        os.path.join(EXAMPLES_PATH),
-                        ["--mill-feed-direction=invalid_value"],
-                        101)] +
-              [TestCase("zchange_below_zdrill",
-                        os.path.join(EXAMPLES_PATH, "multivibrator-zchange-absolute"),
-                        ["--zchange-absolute=false"],
-                        19)]
-)
+from integration_test_cases import TEST_CASES
 
 def colored(text, **color):
   """Colorize text if supported."""
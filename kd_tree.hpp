@@ -0,0 +1,211 @@
+#ifndef KD_TREE_HPP
+#define KD_TREE_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "geometry.hpp"
+
+// A 2-d tree of points for finding the nearest point by Chebyshev
+// distance.  Points can be removed but not added.  The tree is stored
+// implicitly in an array: the node for the range [begin, end) is at
+// the middle of the range and the children are in the halves on
+// either side of it.
+template <typename point_t>
+class KdTree {
+  typedef typename bg::coordinate_type<point_t>::type coordinate_t;
+
+ public:
+  explicit KdTree(const std::vector<point_t>& points) :
+      points(points),
+      order(points.size()),
+      position(points.size()),
+      removed(points.size(), false),
+      alive(points.size()),
+      remaining(points.size()) {
+    for (size_t i = 0; i < order.size(); i++) {
+      order[i] = i;
+    }
+    build(0, order.size(), 0);
+    for (size_t i = 0; i < order.size(); i++) {
+      position[order[i]] = i;
+    }
+  }
+
+  // How many points have not yet been removed.
+  size_t size() const {
+    return remaining;
+  }
+
+  // Remove the point with this index.  Removing a point twice does nothing.
+  void remove(size_t index) {
+    const size_t target = position[index];
+    if (removed[target]) {
+      return;
+    }
+    removed[target] = true;
+    remaining--;
+    size_t begin = 0;
+    size_t end = order.size();
+    while (true) {
+      const size_t mid = begin + (end - begin) / 2;
+      alive[mid]--;
+      if (mid == target) {
+        return;
+      }
+      if (target < mid) {
+        end = mid;
+      } else {
+        begin = mid + 1;
+      }
+    }
+  }
+
+  // Returns the index of the point that is nearest to p by Chebyshev
+  // distance, of those not removed.  If there are many at the same
+  // distance, the lowest index is returned.  The tree must not be
+  // empty.
+  size_t nearest(const point_t& p) const {
+    size_t best_index = points.size();
+    auto best_distance = std::numeric_limits<coordinate_t>::infinity();
+    nearest(p, 0, order.size(), 0, best_distance, best_index);
+    return best_index;
+  }
+
+  // Returns the indices of the k points nearest to p by Chebyshev
+  // distance, of those not removed, from nearest to farthest.  Ties
+  // are ordered by index.  Fewer than k are returned if there aren't
+  // enough points.
+  std::vector<size_t> nearest(const point_t& p, size_t k) const {
+    std::vector<std::pair<coordinate_t, size_t>> best;
+    if (k > 0) {
+      best.reserve(k + 1);
+      nearest(p, k, 0, order.size(), 0, best);
+    }
+    std::sort_heap(best.begin(), best.end());
+    std::vector<size_t> result;
+    result.reserve(best.size());
+    for (const auto& b : best) {
+      result.push_back(b.second);
+    }
+    return result;
+  }
+
+ private:
+  static coordinate_t coordinate(const point_t& p, bool on_x) {
+    return on_x ? p.x() : p.y();
+  }
+
+  void build(size_t begin, size_t end, size_t depth) {
+    if (begin >= end) {
+      return;
+    }
+    const size_t mid = begin + (end - begin) / 2;
+    const bool on_x = depth % 2 == 0;
+    // Break ties by index so that the tree is always the same.
+    std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end,
+                     [&](size_t a, size_t b) {
+                       return std::make_tuple(coordinate(points[a], on_x), a) <
+                           std::make_tuple(coordinate(points[b], on_x), b);
+                     });
+    alive[mid] = end - begin;
+    build(begin, mid, depth + 1);
+    build(mid + 1, end, depth + 1);
+  }
+
+  void nearest(const point_t& p, size_t begin, size_t end, size_t depth,
+               coordinate_t& best_distance, size_t& best_index) const {
+    if (begin >= end) {
+      return;
+    }
+    const size_t mid = begin + (end - begin) / 2;
+    if (alive[mid] == 0) {
+      return;
+    }
+    const auto& current = points[order[mid]];
+    if (!removed[mid]) {
+      const auto distance = std::max(std::abs(p.x() - current.x()),
+                                     std::abs(p.y() - current.y()));
+      if (distance < best_distance ||
+          (distance == best_distance && order[mid] < best_index)) {
+        best_distance = distance;
+        best_index = order[mid];
+      }
+    }
+    const bool on_x = depth % 2 == 0;
+    const auto difference = coordinate(p, on_x) - coordinate(current, on_x);
+    // Search the side with p first because it's more likely to have
+    // the nearest.  The other side can only have a point at least
+    // difference away.
+    if (difference < 0) {
+      nearest(p, begin, mid, depth + 1, best_distance, best_index);
+      if (-difference <= best_distance) {
+        nearest(p, mid + 1, end, depth + 1, best_distance, best_index);
+      }
+    } else {
+      nearest(p, mid + 1, end, depth + 1, best_distance, best_index);
+      if (difference <= best_distance) {
+        nearest(p, begin, mid, depth + 1, best_distance, best_index);
+      }
+    }
+  }
+
+  // best is a max-heap of at most k (distance, index) pairs.
+  void nearest(const point_t& p, size_t k, size_t begin, size_t end, size_t depth,
+               std::vector<std::pair<coordinate_t, size_t>>& best) const {
+    if (begin >= end) {
+      return;
+    }
+    const size_t mid = begin + (end - begin) / 2;
+    if (alive[mid] == 0) {
+      return;
+    }
+    const auto& current = points[order[mid]];
+    if (!removed[mid]) {
+      const auto candidate = std::make_pair(std::max(std::abs(p.x() - current.x()),
+                                                     std::abs(p.y() - current.y())),
+                                            order[mid]);
+      if (best.size() < k || candidate < best.front()) {
+        best.push_back(candidate);
+        std::push_heap(best.begin(), best.end());
+        if (best.size() > k) {
+          std::pop_heap(best.begin(), best.end());
+          best.pop_back();
+        }
+      }
+    }
+    const bool on_x = depth % 2 == 0;
+    const auto difference = coordinate(p, on_x) - coordinate(current, on_x);
+    const auto worst = [&]() {
+      return best.size() < k ? std::numeric_limits<coordinate_t>::infinity() : best.front().first;
+    };
+    if (difference < 0) {
+      nearest(p, k, begin, mid, depth + 1, best);
+      if (-difference <= worst()) {
+        nearest(p, k, mid + 1, end, depth + 1, best);
+      }
+    } else {
+      nearest(p, k, mid + 1, end, depth + 1, best);
+      if (difference <= worst()) {
+        nearest(p, k, begin, mid, depth + 1, best);
+      }
+    }
+  }
+
+  const std::vector<point_t> points;
+  // The index of the point at each position in the tree.
+  std::vector<size_t> order;
+  // The position in the tree of each point index.
+  std::vector<size_t> position;
+  // By position.
+  std::vector<bool> removed;
+  // The number of points not removed in the subtree at each position.
+  std::vector<size_t> alive;
+  size_t remaining;
+};
+
+#endif // KD_TREE_HPP
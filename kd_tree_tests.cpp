@@ -0,0 +1,48 @@
+#define BOOST_TEST_MODULE kd tree tests
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+#include "geometry.hpp"
+#include "kd_tree.hpp"
+
+using std::vector;
+
+BOOST_AUTO_TEST_SUITE(kd_tree_tests)
+
+BOOST_AUTO_TEST_CASE(nearest) {
+  vector<point_type_fp> points{{0, 0}, {10, 0}, {0, 10}, {5, 5}, {3, 9}};
+  KdTree<point_type_fp> tree(points);
+  BOOST_CHECK_EQUAL(tree.size(), 5);
+  BOOST_CHECK_EQUAL(tree.nearest(point_type_fp(1, 1)), 0);
+  BOOST_CHECK_EQUAL(tree.nearest(point_type_fp(9, 1)), 1);
+  // Chebyshev distance to {5,5} is 3 and to {3,9} is 3, so the lower index wins.
+  BOOST_CHECK_EQUAL(tree.nearest(point_type_fp(2, 6)), 3);
+  tree.remove(3);
+  BOOST_CHECK_EQUAL(tree.size(), 4);
+  BOOST_CHECK_EQUAL(tree.nearest(point_type_fp(2, 6)), 4);
+  tree.remove(3);
+  BOOST_CHECK_EQUAL(tree.size(), 4);
+}
+
+BOOST_AUTO_TEST_CASE(duplicates) {
+  vector<point_type_fp> points(10, point_type_fp(1, 1));
+  KdTree<point_type_fp> tree(points);
+  for (size_t i = 0; i < points.size(); i++) {
+    BOOST_CHECK_EQUAL(tree.nearest(point_type_fp(0, 0)), i);
+    tree.remove(i);
+  }
+  BOOST_CHECK_EQUAL(tree.size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(k_nearest) {
+  vector<point_type_fp> points{{0, 0}, {10, 0}, {0, 10}, {5, 5}, {3, 9}};
+  KdTree<point_type_fp> tree(points);
+  BOOST_CHECK(tree.nearest(point_type_fp(2, 6), 0).empty());
+  BOOST_CHECK((tree.nearest(point_type_fp(2, 6), 3) == vector<size_t>{3, 4, 2}));
+  BOOST_CHECK((tree.nearest(point_type_fp(2, 6), 10) == vector<size_t>{3, 4, 2, 0, 1}));
+  tree.remove(4);
+  BOOST_CHECK((tree.nearest(point_type_fp(2, 6), 2) == vector<size_t>{3, 2}));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
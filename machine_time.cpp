@@ -0,0 +1,89 @@
+#include <algorithm>
+#include <cmath>
+
+#include "machine_time.hpp"
+
+// The speeds in mill are in inches per minute.
+MachineTime::MachineTime(const RoutingMill& mill) :
+    zsafe(mill.zsafe),
+    zwork(mill.zwork),
+    feed(mill.feed / 60),
+    vertfeed(mill.vertfeed / 60),
+    g0_vertical_speed(mill.g0_vertical_speed / 60),
+    g0_horizontal_speed(mill.g0_horizontal_speed / 60),
+    bridges_height(dynamic_cast<const Cutter*>(&mill) ?
+                   dynamic_cast<const Cutter*>(&mill)->bridges_height :
+                   0),
+    // Same as in NGC_Exporter.
+    passes(mill.stepsize == 0 ?
+           1 :
+           std::max(std::ceil(-mill.zwork / mill.stepsize), 1.0)) {}
+
+static double chebyshev(const point_type_fp& p0, const point_type_fp& p1) {
+  return std::max(std::abs(p0.x() - p1.x()),
+                  std::abs(p0.y() - p1.y()));
+}
+
+double MachineTime::operator()(const point_type_fp& from, const point_type_fp& to) const {
+  const double first_pass_z = zwork / passes;
+  return (zsafe - zwork) / g0_vertical_speed +
+      chebyshev(from, to) / g0_horizontal_speed +
+      (zsafe - first_pass_z) / vertfeed;
+}
+
+double MachineTime::milling(const linestring_type_fp& path, const std::vector<size_t>& bridges) const {
+  if (path.size() == 0) {
+    return 0;
+  }
+  double time = 0;
+  const bool closed = bg::equals(path.front(), path.back());
+  // The plunge to the first pass is in operator().
+  double current_z = zwork / passes;
+  for (unsigned int i = 0; i < passes; i++) {
+    const double z = zwork / passes * (i + 1);
+    if (i > 0) {
+      if (closed) {
+        time += (current_z - z) / vertfeed;
+      } else {
+        // Retract, go back to the start, and plunge.
+        time += (zsafe - current_z) / g0_vertical_speed +
+            chebyshev(path.back(), path.front()) / g0_horizontal_speed +
+            (zsafe - z) / vertfeed;
+      }
+    }
+    // Same as in NGC_Exporter::cutter_milling.
+    bool in_bridge = false;
+    auto current_bridge = bridges.cbegin();
+    for (size_t current = 1; current < path.size(); current++) {
+      while (current_bridge != bridges.cend() && *current_bridge < current - 1) {
+        current_bridge++;
+      }
+      const bool is_bridge_cut = current_bridge != bridges.cend() && *current_bridge == current - 1;
+      if (is_bridge_cut && z < bridges_height && !in_bridge) {
+        time += (bridges_height - z) / g0_vertical_speed;
+        in_bridge = true;
+      } else if (!is_bridge_cut && in_bridge) {
+        time += (bridges_height - z) / vertfeed;
+        in_bridge = false;
+      }
+      time += bg::distance(path[current-1], path[current]) / feed;
+    }
+    current_z = in_bridge ? bridges_height : z;
+  }
+  return time;
+}
+
+double MachineTime::total(const multi_linestring_type_fp& paths, point_type_fp& position,
+                          const std::vector<std::vector<size_t>>& bridges) const {
+  const std::vector<size_t> no_bridges;
+  double time = 0;
+  for (size_t i = 0; i < paths.size(); i++) {
+    const auto& path = paths[i];
+    if (path.size() == 0) {
+      continue;
+    }
+    time += (*this)(position, path.front()) + milling(path, bridges.empty() ? no_bridges : bridges[i]);
+    position = path.back();
+  }
+  return time;
+}
@@ -0,0 +1,52 @@
+#ifndef MACHINE_TIME_HPP
+#define MACHINE_TIME_HPP
+
+#include <vector>
+
+#include "geometry.hpp"
+#include "mill.hpp"
+
+// Estimates how many seconds a machine needs for the moves that
+// NGC_Exporter writes for a RoutingMill.  Each path is reached with a
+// retract to zsafe, a rapid move and a plunge at vertfeed and then it
+// is milled in as many infeed passes as the stepsize requires.  A
+// Cutter also goes up to bridges_height and back down for each
+// bridge.  Rapid moves go in both axes at once so they take the
+// Chebyshev distance divided by g0_horizontal_speed.  Acceleration is
+// ignored.
+//
+// NGC_Exporter retracts between every two paths, so the time between
+// them is a constant plus the rapid and orders paths exactly like the
+// Chebyshev distance that tsp_solver uses.  That's why this is only
+// used for the estimate and not for ordering.
+class MachineTime {
+ public:
+  explicit MachineTime(const RoutingMill& mill);
+
+  // Time to go from the end of one path to the start of another and
+  // plunge for the first pass.
+  double operator()(const point_type_fp& from, const point_type_fp& to) const;
+  // Time to mill the path in all its passes, including the moves
+  // between passes.  The path is milled in the direction given.  The
+  // bridges are the indices of the segments that are bridges, as
+  // from Layer::get_bridges, and only a Cutter has them.
+  double milling(const linestring_type_fp& path, const std::vector<size_t>& bridges = {}) const;
+  // Time to go to and mill each path in order, beginning at position.
+  // Afterwards position is where the last path ends.  If bridges
+  // isn't empty, it has the bridges of each path.
+  double total(const multi_linestring_type_fp& paths, point_type_fp& position,
+               const std::vector<std::vector<size_t>>& bridges = {}) const;
+
+ private:
+  // All speeds are in inches per second.
+  const double zsafe;
+  const double zwork;
+  const double feed;
+  const double vertfeed;
+  const double g0_vertical_speed;
+  const double g0_horizontal_speed;
+  const double bridges_height;
+  const unsigned int passes;
+};
+
+#endif //MACHINE_TIME_HPP
@@ -0,0 +1,80 @@
+#define BOOST_TEST_MODULE machine time tests
+#include <boost/test/unit_test.hpp>
+
+#include "geometry.hpp"
+#include "mill.hpp"
+#include "machine_time.hpp"
+
+BOOST_AUTO_TEST_SUITE(machine_time_tests)
+
+// Speeds are in inches per minute, so 60 is 1 inch per second.
+RoutingMill make_mill(double stepsize) {
+  RoutingMill mill;
+  mill.zsafe = 1;
+  mill.zwork = -1;
+  mill.feed = 60;
+  mill.vertfeed = 30;
+  mill.g0_vertical_speed = 120;
+  mill.g0_horizontal_speed = 240;
+  mill.stepsize = stepsize;
+  return mill;
+}
+
+BOOST_AUTO_TEST_CASE(transition) {
+  MachineTime machine_time(make_mill(0));
+  // Retract 2 inches at 2in/s, move 4 inches at 4in/s, plunge 2 inches at 0.5in/s.
+  BOOST_CHECK_CLOSE(machine_time(point_type_fp(0, 0), point_type_fp(4, 3)), 1 + 1 + 4, 1e-9);
+  BOOST_CHECK_CLOSE(machine_time(point_type_fp(0, 0), point_type_fp(0, 0)), 1 + 4, 1e-9);
+}
+
+BOOST_AUTO_TEST_CASE(one_pass) {
+  MachineTime machine_time(make_mill(0));
+  BOOST_CHECK_CLOSE(machine_time.milling(linestring_type_fp{{0, 0}, {3, 4}}), 5, 1e-9);
+  BOOST_CHECK_EQUAL(machine_time.milling(linestring_type_fp{}), 0);
+}
+
+BOOST_AUTO_TEST_CASE(infeed_passes) {
+  MachineTime machine_time(make_mill(0.5));
+  // A loop is milled twice with a plunge of 0.5 inches in between.
+  BOOST_CHECK_CLOSE(machine_time.milling(linestring_type_fp{{0, 0}, {1, 0}, {1, 1}, {0, 0}}),
+                    2 * (2 + std::sqrt(2)) + 1, 1e-9);
+  // An open path needs a retract from -0.5, a move back and a plunge to -1 in between.
+  BOOST_CHECK_CLOSE(machine_time.milling(linestring_type_fp{{0, 0}, {4, 0}}),
+                    2 * 4 + 0.75 + 1 + 4, 1e-9);
+  // The plunge for the first pass is only to -0.5.
+  BOOST_CHECK_CLOSE(machine_time(point_type_fp(0, 0), point_type_fp(0, 0)), 1 + 3, 1e-9);
+}
+
+BOOST_AUTO_TEST_CASE(total) {
+  MachineTime machine_time(make_mill(0));
+  multi_linestring_type_fp paths{{{4, 0}, {4, 1}}, {}, {{4, 5}, {0, 5}}};
+  point_type_fp position(0, 0);
+  BOOST_CHECK_CLOSE(machine_time.total(paths, position),
+                    (1 + 1 + 4) + 1 + (1 + 1 + 4) + 4, 1e-9);
+  BOOST_CHECK(bg::equals(position, point_type_fp(0, 5)));
+}
+
+BOOST_AUTO_TEST_CASE(bridges) {
+  Cutter cutter;
+  static_cast<RoutingMill&>(cutter) = make_mill(0.5);
+  cutter.bridges_height = 0;
+  MachineTime machine_time(cutter);
+  // The second segment is a bridge.  The first pass at -0.5 goes up
+  // 0.5 inches at 2in/s for it and back down at 0.5in/s.  The second
+  // pass at -1 goes up and down 1 inch.
+  const linestring_type_fp path{{0, 0}, {1, 0}, {2, 0}, {3, 0}, {0, 0}};
+  const double without_bridges = machine_time.milling(path);
+  BOOST_CHECK_CLOSE(without_bridges, 2 * 6 + 1, 1e-9);
+  BOOST_CHECK_CLOSE(machine_time.milling(path, {1}), without_bridges + (0.25 + 1) + (0.5 + 2), 1e-9);
+  // Two bridges in a row are milled without going down in between.
+  BOOST_CHECK_CLOSE(machine_time.milling(path, {1, 2}), without_bridges + (0.25 + 1) + (0.5 + 2), 1e-9);
+  // A bridge at the end isn't followed by going down, so the plunge
+  // for the second pass starts at bridges_height.
+  BOOST_CHECK_CLOSE(machine_time.milling(path, {3}), without_bridges + 0.25 + 0.5 + (2 - 1), 1e-9);
+
+  point_type_fp position(0, 0);
+  BOOST_CHECK_CLOSE(machine_time.total(multi_linestring_type_fp{path}, position, {{1}}),
+                    machine_time(point_type_fp(0, 0), path.front()) + machine_time.milling(path, {1}), 1e-9);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -24,6 +24,7 @@
 #include <fstream>
 #include <sstream>
 #include <memory>
+#include <future>
 
 #include <vector>
 using std::vector;
@@ -45,6 +46,9 @@ using std::string;
 #include "drill.hpp"
 #include "options.hpp"
 #include "units.hpp"
+#include "thread_pool.hpp"
+#include "profile.hpp"
+#include "merge_near_points.hpp"
 
 #include <boost/algorithm/string.hpp>
 #include <boost/version.hpp>
@@ -73,6 +77,8 @@ void do_pcb2gcode(int argc, const char* argv[]) {
     }
 
     options::check_parameters();      //check the cli parameters
+    profile::enable(vm.count("profile") > 0);
+    set_default_merge_algorithm(vm["merge-near-points-grid"].as<bool>() ? MergeAlgorithm::GRID : MergeAlgorithm::MAP);
 
     //---------------------------------------------------------------------------
     //deal with metric / imperial units for input parameters:
@@ -102,6 +108,7 @@ void do_pcb2gcode(int argc, const char* argv[]) {
                   boost::apply_visitor(percent_visitor(tool_diameter), vm["milling-overlap"].as<boost::variant<Length, Percent>>()).asInch(unit)));
         }
         isolator->voronoi = vm["voronoi"].as<bool>();
+        isolator->voronoi_tiles = vm["voronoi-tiles"].as<unsigned int>();
         isolator->zwork = vm["zwork"].as<Length>().asInch(unit);
         isolator->zsafe = vm["zsafe"].as<Length>().asInch(unit);
         isolator->feed = vm["mill-feed"].as<Velocity>().asInchPerMinute(unit);
@@ -260,13 +267,19 @@ void do_pcb2gcode(int argc, const char* argv[]) {
 
     //---------------------------------------------------------------------------
 
+    auto thread_pool = make_shared<ThreadPool>(vm["threads"].as<unsigned int>());
+
     auto board = make_shared<Board>(
         vm["fill-outline"].as<bool>(),
         outputdir,
+        vm["cache-dir"].as<string>(),
         vm["tsp-2opt"].as<bool>(),
+        vm["tsp-2opt-neighbours"].as<size_t>(),
+        vm["tsp-time-limit"].as<double>(),
         vm["mill-feed-direction"].as<MillFeedDirection::MillFeedDirection>(),
         vm["invert-gerbers"].as<bool>(),
-        !vm["draw-gerber-lines"].as<bool>());
+        !vm["draw-gerber-lines"].as<bool>(),
+        thread_pool);
 
     // this is currently disabled, use --outline instead
     if (vm.count("margins"))
@@ -320,6 +333,42 @@ void do_pcb2gcode(int argc, const char* argv[]) {
     board->createLayers();
     cout << "DONE.\n";
 
+    // The drill only needs the size of the board so it can be imported
+    // and optimized while the other layers are exported.  Anything that
+    // it would print is kept until the drill is exported.
+    const auto make_drill_processor = [&vm, board]() {
+      point_type_fp min;
+      point_type_fp max;
+
+      //Check if there are layers in "board"; if not, we have to compute
+      //the size of the board now, based only on the size of the drill layer
+      //(the resulting drill gcode will be probably misaligned, but this is the
+      //best we can do)
+      if(board->get_layersnum() == 0)
+      {
+        auto importer = make_shared<GerberImporter>();
+        if (!importer->load_file(vm["drill"].as<string>())) {
+          options::maybe_throw("ERROR.", ERR_INVALIDPARAMETER);
+        }
+        min = importer->get_bounding_box().min_corner();
+        max = importer->get_bounding_box().max_corner();
+      } else {
+        min = board->get_bounding_box().min_corner();
+        max = board->get_bounding_box().max_corner();
+      }
+
+      auto ep = make_shared<ExcellonProcessor>(vm, min, max);
+      ep->optimize(vm["onedrill"].as<bool>());
+      return ep;
+    };
+    // Without layers there is nothing to export in the meantime and
+    // importing the drill file for its size might print, so it's done
+    // in order below.
+    std::future<shared_ptr<ExcellonProcessor>> drill_processor;
+    if (vm.count("drill") > 0 && board->get_layersnum() > 0) {
+      drill_processor = thread_pool->submit(make_drill_processor);
+    }
+
     if (!vm["no-export"].as<bool>()) {
       auto exporter = make_shared<NGC_Exporter>(board);
       exporter->add_header(PACKAGE_STRING);
@@ -343,27 +392,10 @@ void do_pcb2gcode(int argc, const char* argv[]) {
     if (vm.count("drill") > 0) {
         try
         {
-            point_type_fp min;
-            point_type_fp max;
-
-            //Check if there are layers in "board"; if not, we have to compute
-            //the size of the board now, based only on the size of the drill layer
-            //(the resulting drill gcode will be probably misaligned, but this is the
-            //best we can do)
-            if(board->get_layersnum() == 0)
-            {
-              auto importer = make_shared<GerberImporter>();
-              if (!importer->load_file(vm["drill"].as<string>())) {
-                options::maybe_throw("ERROR.", ERR_INVALIDPARAMETER);
-              }
-              min = importer->get_bounding_box().min_corner();
-              max = importer->get_bounding_box().max_corner();
-            } else {
-              min = board->get_bounding_box().min_corner();
-              max = board->get_bounding_box().max_corner();
-            }
-
-            ExcellonProcessor ep(vm, min, max);
+            const shared_ptr<ExcellonProcessor> drill_processor_ptr =
+                drill_processor.valid() ? drill_processor.get() : make_drill_processor();
+            ExcellonProcessor& ep = *drill_processor_ptr;
+            ep.print_parse_warnings();
 
             ep.add_header(PACKAGE_STRING);
 
@@ -415,6 +447,16 @@ void do_pcb2gcode(int argc, const char* argv[]) {
 
     cout << "END." << endl;
 
+    if (vm.count("profile")) {
+        const string profile_filename = vm["profile"].as<string>();
+        if (profile_filename.empty()) {
+            profile::report_table(cout);
+        } else {
+            std::ofstream profile_file(profile_filename);
+            profile::report_json(profile_file);
+        }
+    }
+
 }
 
 int main(int argc, const char* argv[]) {
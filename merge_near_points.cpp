@@ -1,5 +1,13 @@
 #include "geometry.hpp"
 #include "bg_operators.hpp"
+#include "merge_near_points.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <cstdint>
 
 #include <vector>
 using std::vector;
@@ -7,6 +15,16 @@ using std::vector;
 #include <utility>
 using std::pair;
 
+static std::atomic<MergeAlgorithm> default_algorithm(MergeAlgorithm::MAP);
+
+void set_default_merge_algorithm(MergeAlgorithm algorithm) {
+  default_algorithm = algorithm;
+}
+
+MergeAlgorithm default_merge_algorithm() {
+  return default_algorithm;
+}
+
 // Points that are very close to each other, probably because of a rounding
 // error, are merged together to a single location.
 size_t merge_near_points(std::map<point_type_fp, point_type_fp>& points, const coordinate_type_fp distance) {
@@ -29,38 +47,167 @@ size_t merge_near_points(std::map<point_type_fp, point_type_fp>& points, const c
   return points_merged;
 }
 
-size_t merge_near_points(vector<pair<linestring_type_fp, bool>>& mls, const coordinate_type_fp distance) {
-  std::map<point_type_fp, point_type_fp> points;
-  for (const auto& ls_and_allow_reversal : mls) {
-    for (const auto& point : ls_and_allow_reversal.first) {
-      points[point] = point;
+// Call f on a reference to each point in the paths.
+template <typename F>
+static void for_each_point(vector<pair<linestring_type_fp, bool>>& mls, const F& f) {
+  for (auto& ls_and_allow_reversal : mls) {
+    for (auto& point : ls_and_allow_reversal.first) {
+      f(point);
+    }
+  }
+}
+
+template <typename F>
+static void for_each_point(multi_linestring_type_fp& mls, const F& f) {
+  for (auto& ls : mls) {
+    for (auto& point : ls) {
+      f(point);
     }
   }
+}
+
+template <typename T>
+static size_t merge_near_points_map(T& mls, const coordinate_type_fp distance) {
+  std::map<point_type_fp, point_type_fp> points;
+  for_each_point(mls, [&](const point_type_fp& point) { points[point] = point; });
   size_t points_merged = merge_near_points(points, distance);
   if (points_merged > 0) {
-    for (auto& ls_and_allow_reversal : mls) {
-      for (auto& point : ls_and_allow_reversal.first) {
-        point = points[point];
-      }
-    }
+    for_each_point(mls, [&](point_type_fp& point) { point = points[point]; });
   }
   return points_merged;
 }
 
-size_t merge_near_points(multi_linestring_type_fp& mls, const coordinate_type_fp distance) {
-  std::map<point_type_fp, point_type_fp> points;
-  for (const auto& ls : mls) {
-    for (const auto& point : ls) {
-      points[point] = point;
+// A hash table from square cells to the first point in each cell,
+// stored flat and searched with linear probing.  Nothing is ever
+// removed.
+class CellTable {
+ public:
+  typedef pair<long long, long long> cell_t;
+  static const size_t none = std::numeric_limits<size_t>::max();
+
+  // It can hold up to max_size cells.
+  explicit CellTable(size_t max_size) {
+    size_t size = 1;
+    while (size < max_size * 2) {
+      size *= 2;
     }
+    slots.resize(size, std::make_pair(cell_t(), none));
   }
-  size_t points_merged = merge_near_points(points, distance);
-  if (points_merged > 0) {
-    for (auto& ls : mls) {
-      for (auto& point : ls) {
-        point = points[point];
+
+  // Returns a reference to the first point in the cell, which is
+  // none for an empty cell.
+  size_t& operator[](const cell_t& cell) {
+    for (size_t slot = hash(cell);; slot = (slot + 1) & (slots.size() - 1)) {
+      if (slots[slot].second == none) {
+        slots[slot].first = cell;
+        return slots[slot].second;
+      }
+      if (slots[slot].first == cell) {
+        return slots[slot].second;
       }
     }
   }
+
+  size_t find(const cell_t& cell) const {
+    for (size_t slot = hash(cell);; slot = (slot + 1) & (slots.size() - 1)) {
+      if (slots[slot].second == none || slots[slot].first == cell) {
+        return slots[slot].second;
+      }
+    }
+  }
+
+ private:
+  size_t hash(const cell_t& cell) const {
+    // Mix the bits so that nearby cells are spread out.
+    uint64_t h = static_cast<uint64_t>(cell.first) * 0x9E3779B97F4A7C15ULL ^
+                 static_cast<uint64_t>(cell.second) * 0xC2B2AE3D27D4EB4FULL;
+    h ^= h >> 29;
+    return h & (slots.size() - 1);
+  }
+
+  vector<pair<cell_t, size_t>> slots;
+};
+
+const size_t CellTable::none;
+
+// The points are visited in sorted order.  Each point is moved to the
+// nearest point already visited and not moved, if there is one within
+// distance.  Only those points are put in the grid and no two of them
+// are within distance of each other so a cell can't have more than a
+// few of them and each search is O(1).
+template <typename T>
+static size_t merge_near_points_grid(T& mls, const coordinate_type_fp distance) {
+  if (!(distance > 0)) {
+    return 0;
+  }
+  vector<point_type_fp> points;
+  for_each_point(mls, [&](const point_type_fp& point) { points.push_back(point); });
+  std::sort(points.begin(), points.end());
+  // Compare exactly, like the sort and the lower_bound below, so that
+  // every point is found again.  bg::equals has a tolerance.
+  points.erase(std::unique(points.begin(), points.end(),
+                           [](const point_type_fp& a, const point_type_fp& b) {
+                             return a.x() == b.x() && a.y() == b.y();
+                           }),
+               points.end());
+
+  const auto get_cell = [&](const point_type_fp& p) {
+    return CellTable::cell_t(std::floor(p.x() / distance), std::floor(p.y() / distance));
+  };
+  CellTable first_in_cell(points.size());
+  // The next point after each point in the same cell.
+  vector<size_t> next_in_cell(points.size(), CellTable::none);
+  vector<point_type_fp> targets(points);
+  const auto distance_2 = distance * distance;
+  size_t points_merged = 0;
+  for (size_t i = 0; i < points.size(); i++) {
+    const auto cell = get_cell(points[i]);
+    size_t nearest = CellTable::none;
+    auto nearest_distance_2 = distance_2;
+    for (auto x = cell.first - 1; x <= cell.first + 1; x++) {
+      for (auto y = cell.second - 1; y <= cell.second + 1; y++) {
+        for (size_t j = first_in_cell.find(CellTable::cell_t(x, y));
+             j != CellTable::none;
+             j = next_in_cell[j]) {
+          const auto current_distance_2 = bg::comparable_distance(points[i], points[j]);
+          if (current_distance_2 < nearest_distance_2 ||
+              (current_distance_2 == nearest_distance_2 && j < nearest)) {
+            nearest = j;
+            nearest_distance_2 = current_distance_2;
+          }
+        }
+      }
+    }
+    if (nearest != CellTable::none) {
+      targets[i] = points[nearest];
+      points_merged++;
+    } else {
+      size_t& first = first_in_cell[cell];
+      next_in_cell[i] = first;
+      first = i;
+    }
+  }
+  if (points_merged > 0) {
+    for_each_point(mls, [&](point_type_fp& point) {
+      const auto found = std::lower_bound(points.cbegin(), points.cend(), point);
+      point = targets[found - points.cbegin()];
+    });
+  }
   return points_merged;
 }
+
+size_t merge_near_points(vector<pair<linestring_type_fp, bool>>& mls, const coordinate_type_fp distance,
+                         MergeAlgorithm algorithm) {
+  if (algorithm == MergeAlgorithm::MAP) {
+    return merge_near_points_map(mls, distance);
+  }
+  return merge_near_points_grid(mls, distance);
+}
+
+size_t merge_near_points(multi_linestring_type_fp& mls, const coordinate_type_fp distance,
+                         MergeAlgorithm algorithm) {
+  if (algorithm == MergeAlgorithm::MAP) {
+    return merge_near_points_map(mls, distance);
+  }
+  return merge_near_points_grid(mls, distance);
+}
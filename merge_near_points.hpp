@@ -4,7 +4,24 @@
 #include <vector>
 #include <utility>
 
-size_t merge_near_points(std::vector<std::pair<linestring_type_fp, bool>>& mls, const coordinate_type_fp distance);
-size_t merge_near_points(multi_linestring_type_fp& mls, const coordinate_type_fp distance);
+// How merge_near_points finds the points that are near each other.
+// MAP scans a std::map sorted by x and can miss some merges.  GRID
+// puts the points into square cells the size of the distance so that
+// only the neighbouring cells need to be searched, which is faster
+// and finds every merge, but it can move points differently than MAP.
+enum class MergeAlgorithm { GRID, MAP };
+
+// The algorithm used when none is given.  It is MAP unless
+// --merge-near-points-grid was given.
+void set_default_merge_algorithm(MergeAlgorithm algorithm);
+MergeAlgorithm default_merge_algorithm();
+
+// Points that are very close to each other, probably because of a
+// rounding error, are merged together to a single location.  Returns
+// the number of points moved.
+size_t merge_near_points(std::vector<std::pair<linestring_type_fp, bool>>& mls, const coordinate_type_fp distance,
+                         MergeAlgorithm algorithm = default_merge_algorithm());
+size_t merge_near_points(multi_linestring_type_fp& mls, const coordinate_type_fp distance,
+                         MergeAlgorithm algorithm = default_merge_algorithm());
 
 #endif //MERGE_NEAR_POINTS_HPP
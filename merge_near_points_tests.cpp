@@ -0,0 +1,86 @@
+#define BOOST_TEST_MODULE merge near points tests
+#include <boost/test/unit_test.hpp>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "geometry.hpp"
+#include "bg_operators.hpp"
+#include "merge_near_points.hpp"
+
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(merge_near_points_tests)
+
+BOOST_AUTO_TEST_CASE(pair_of_points) {
+  for (auto algorithm : {MergeAlgorithm::GRID, MergeAlgorithm::MAP}) {
+    multi_linestring_type_fp mls{{{0, 0}, {1, 0}}, {{1.05, 0.05}, {2, 2}}};
+    BOOST_CHECK_EQUAL(merge_near_points(mls, 0.1, algorithm), 1UL);
+    multi_linestring_type_fp expected{{{0, 0}, {1, 0}}, {{1, 0}, {2, 2}}};
+    BOOST_CHECK_EQUAL(mls, expected);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(same_x) {
+  vector<pair<linestring_type_fp, bool>> mls{{{{0, 1}, {0, 0}}, true}, {{{0, 1.01}, {5, 5}}, false}};
+  BOOST_CHECK_EQUAL(merge_near_points(mls, 0.1), 1UL);
+  vector<pair<linestring_type_fp, bool>> expected{{{{0, 1}, {0, 0}}, true}, {{{0, 1}, {5, 5}}, false}};
+  BOOST_CHECK_EQUAL(mls, expected);
+}
+
+BOOST_AUTO_TEST_CASE(nothing_near) {
+  multi_linestring_type_fp mls{{{0, 0}, {1, 0}}, {{1, 1}, {1, 0}}};
+  const auto expected = mls;
+  BOOST_CHECK_EQUAL(merge_near_points(mls, 0.5), 0UL);
+  BOOST_CHECK_EQUAL(merge_near_points(mls, 0), 0UL);
+  BOOST_CHECK_EQUAL(mls, expected);
+}
+
+// Points that differ by an ulp are distinct points in the grid and
+// must still be found after deduplicating.
+BOOST_AUTO_TEST_CASE(almost_equal) {
+  multi_linestring_type_fp mls{{{0, 0}, {0, 1e-6}}, {{1, 5}, {std::nextafter(1.0, 2.0), 5}}};
+  BOOST_CHECK_EQUAL(merge_near_points(mls, 1e-5, MergeAlgorithm::GRID), 2UL);
+  multi_linestring_type_fp expected{{{0, 0}, {0, 0}}, {{1, 5}, {1, 5}}};
+  BOOST_CHECK_EQUAL(mls, expected);
+}
+
+BOOST_AUTO_TEST_CASE(default_algorithm) {
+  BOOST_CHECK(default_merge_algorithm() == MergeAlgorithm::MAP);
+  set_default_merge_algorithm(MergeAlgorithm::GRID);
+  BOOST_CHECK(default_merge_algorithm() == MergeAlgorithm::GRID);
+  set_default_merge_algorithm(MergeAlgorithm::MAP);
+}
+
+// Every point is moved by at most distance and afterwards no two
+// points are within distance of each other.  Only GRID guarantees
+// this.
+BOOST_AUTO_TEST_CASE(random_points) {
+  std::mt19937 gen(0);
+  std::uniform_real_distribution<double> coordinate(-1, 1);
+  multi_linestring_type_fp mls;
+  for (int i = 0; i < 1000; i++) {
+    mls.push_back(linestring_type_fp{{coordinate(gen), coordinate(gen)},
+                                     {coordinate(gen), coordinate(gen)}});
+  }
+  const auto original = mls;
+  const double distance = 0.05;
+  BOOST_CHECK_GT(merge_near_points(mls, distance, MergeAlgorithm::GRID), 0UL);
+  vector<point_type_fp> points;
+  for (size_t i = 0; i < mls.size(); i++) {
+    for (size_t j = 0; j < mls[i].size(); j++) {
+      BOOST_CHECK_LE(bg::distance(mls[i][j], original[i][j]), distance);
+      points.push_back(mls[i][j]);
+    }
+  }
+  sort(points.begin(), points.end());
+  points.erase(unique(points.begin(), points.end()), points.end());
+  for (size_t i = 0; i < points.size(); i++) {
+    for (size_t j = i + 1; j < points.size(); j++) {
+      BOOST_CHECK_GT(bg::distance(points[i], points[j]), distance);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
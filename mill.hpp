@@ -75,6 +75,9 @@ class Isolator: public RoutingMill {
   std::vector<std::pair<double, double>> tool_diameters_and_overlap_widths;
   int extra_passes;
   bool voronoi;
+  // Split the voronoi regions into this many rows and columns of
+  // tiles that are computed concurrently.
+  unsigned int voronoi_tiles;
   bool preserve_thermal_reliefs;
   double isolation_width;
 };
@@ -24,6 +24,8 @@
 #include "options.hpp"
 #include <boost/algorithm/string.hpp>
 #include "bg_operators.hpp"
+#include "machine_time.hpp"
+#include "profile.hpp"
 #include <iostream>
 using std::cerr;
 using std::flush;
@@ -41,6 +43,12 @@ using std::vector;
 #include <utility>
 using std::pair;
 
+#include <map>
+using std::map;
+
+#include <future>
+using std::shared_future;
+
 #include <cmath>
 using std::ceil;
 
@@ -78,6 +86,7 @@ void NGC_Exporter::export_all(boost::program_options::variables_map& options)
     bMetricoutput = options["metricoutput"].as<bool>();      //set flag for metric output
     bZchangeG53 = options["zchange-absolute"].as<bool>();
     nom6 = options["nom6"].as<bool>();
+    estimate_runtime = options["estimate-runtime"].as<bool>();
     
     string outputdir = options["output-dir"].as<string>();
     
@@ -86,6 +95,35 @@ void NGC_Exporter::export_all(boost::program_options::variables_map& options)
     
     tileInfo = Tiling::generateTileInfo( options, board->get_height(), board->get_width() );
 
+    // Start computing the toolpaths of all layers at once.  The outline
+    // is the mask of the other layers and computing the outline
+    // toolpath modifies its surface, so it must wait for the others.
+    // The g-code is written serially, in layer order, so that the
+    // unique codes are assigned just like they would be without threads.
+    typedef vector<pair<coordinate_type_fp, multi_linestring_type_fp>> toolpaths_t;
+    map<string, shared_future<toolpaths_t>> all_toolpaths;
+    vector<shared_future<toolpaths_t>> masked_toolpaths;
+    for (const string& layername : board->list_layers()) {
+      if (layername != "outline") {
+        auto layer = board->get_layer(layername);
+        all_toolpaths[layername] = board->get_thread_pool()->submit(
+            [layer]() { return layer->get_toolpaths(); }).share();
+        masked_toolpaths.push_back(all_toolpaths[layername]);
+      }
+    }
+    for (const string& layername : board->list_layers()) {
+      if (layername == "outline") {
+        auto layer = board->get_layer(layername);
+        all_toolpaths[layername] = board->get_thread_pool()->submit(
+            [layer, masked_toolpaths]() {
+              for (const auto& toolpaths : masked_toolpaths) {
+                toolpaths.wait();
+              }
+              return layer->get_toolpaths();
+            }).share();
+      }
+    }
+
     for ( string layername : board->list_layers() )
     {
         if (options["zero-start"].as<bool>()) {
@@ -119,7 +157,7 @@ void NGC_Exporter::export_all(boost::program_options::variables_map& options)
         option_name << layername << "-output";
         string of_name = build_filename(outputdir, options[option_name.str()].as<string>());
         cout << "Exporting " << layername << "... " << flush;
-        export_layer(board->get_layer(layername), of_name, leveller);
+        export_layer(board->get_layer(layername), all_toolpaths.at(layername).get(), of_name, leveller);
         cout << "DONE." << " (Height: " << board->get_height() * cfactor
              << (bMetricoutput ? "mm" : "in") << " Width: "
              << board->get_width() * cfactor << (bMetricoutput ? "mm" : "in")
@@ -243,10 +281,12 @@ void NGC_Exporter::isolation_milling(std::ofstream& of, shared_ptr<RoutingMill>
 }
 
 
-void NGC_Exporter::export_layer(shared_ptr<Layer> layer, string of_name, boost::optional<autoleveller> leveller) {
+void NGC_Exporter::export_layer(shared_ptr<Layer> layer,
+                                vector<pair<coordinate_type_fp, multi_linestring_type_fp>> all_toolpaths,
+                                string of_name, boost::optional<autoleveller> leveller) {
+    profile::Timer timer("NGC_Exporter::export_layer");
     string layername = layer->get_name();
     shared_ptr<RoutingMill> mill = layer->get_manufacturer();
-    vector<pair<coordinate_type_fp, multi_linestring_type_fp>> all_toolpaths = layer->get_toolpaths();
 
     if (all_toolpaths.size() < 1) {
       return; // Nothing to do.
@@ -275,6 +315,47 @@ void NGC_Exporter::export_layer(shared_ptr<Layer> layer, string of_name, boost::
     else
         of << "( Software-independent Gcode )\n";
 
+    shared_ptr<Cutter> cutter = dynamic_pointer_cast<Cutter>(mill);
+    shared_ptr<Isolator> isolator = dynamic_pointer_cast<Isolator>(mill);
+
+    // One list of bridges for each path.
+    vector<vector<size_t>> all_bridges;
+    if (cutter) {
+      for (auto& path : all_toolpaths[0].second) {  // Cutter layer can only have one tool_diameter.
+        auto bridges = layer->get_bridges(path);
+        all_bridges.push_back(bridges);
+      }
+    }
+
+    if (estimate_runtime) {
+      // The same moves as below, tile by tile.  The time for changing
+      // tools depends on the operator so it isn't included.
+      const MachineTime machine_time(*mill);
+      double seconds = 0;
+      point_type_fp machine_position(0, 0);
+      for (const auto& toolpaths : all_toolpaths) {
+        if (toolpaths.second.size() < 1) {
+          continue;
+        }
+        seconds += mill->spindown_time + mill->spinup_time;
+        for (unsigned int i = 0; i < tileInfo.forYNum; i++) {
+          const double yoffsetTot = yoffset - i * tileInfo.boardHeight;
+          for (unsigned int j = 0; j < tileInfo.forXNum; j++) {
+            const double xoffsetTot = xoffset - (i % 2 ? tileInfo.forXNum - j - 1 : j) * tileInfo.boardWidth;
+            // The paths of every tile are in the board's coordinates.
+            point_type_fp position(machine_position.x() + xoffsetTot, machine_position.y() + yoffsetTot);
+            seconds += machine_time.total(toolpaths.second, position, all_bridges);
+            machine_position = point_type_fp(position.x() - xoffsetTot, position.y() - yoffsetTot);
+          }
+        }
+      }
+      if (seconds > 0) {
+        seconds += mill->spindown_time;  // At the end.
+      }
+      of << "( Estimated run time: " << format("%.1f") % (seconds / 60)
+         << " minutes, not including tool changes )\n";
+    }
+
     of.setf(ios_base::fixed);      //write floating-point values in fixed-point notation
     of.precision(5);              //Set floating-point decimal precision
 
@@ -302,18 +383,6 @@ void NGC_Exporter::export_layer(shared_ptr<Layer> layer, string of_name, boost::
       leveller->header(of);
     }
 
-    shared_ptr<Cutter> cutter = dynamic_pointer_cast<Cutter>(mill);
-    shared_ptr<Isolator> isolator = dynamic_pointer_cast<Isolator>(mill);
-
-    // One list of bridges for each path.
-    vector<vector<size_t>> all_bridges;
-    if (cutter) {
-      for (auto& path : all_toolpaths[0].second) {  // Cutter layer can only have one tool_diameter.
-        auto bridges = layer->get_bridges(path);
-        all_bridges.push_back(bridges);
-      }
-    }
-
     uniqueCodes main_sub_ocodes(200);
     for (size_t toolpaths_index = 0; toolpaths_index < all_toolpaths.size(); toolpaths_index++) {
       const auto& toolpaths = all_toolpaths[toolpaths_index].second;
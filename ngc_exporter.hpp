@@ -50,7 +50,9 @@ public:
     void set_postamble(std::string);
 
 protected:
-  void export_layer(std::shared_ptr<Layer> layer, std::string of_name, boost::optional<autoleveller> leveller);
+  void export_layer(std::shared_ptr<Layer> layer,
+                    std::vector<std::pair<coordinate_type_fp, multi_linestring_type_fp>> all_toolpaths,
+                    std::string of_name, boost::optional<autoleveller> leveller);
   void cutter_milling(std::ofstream& of, std::shared_ptr<Cutter> cutter, const linestring_type_fp& path,
                       const std::vector<size_t>& bridges, const double xoffsetTot, const double yoffsetTot);
   void isolation_milling(std::ofstream& of, std::shared_ptr<RoutingMill> mill, const linestring_type_fp& path,
@@ -66,6 +68,7 @@ protected:
     bool bMetricoutput;     //if true, metric g-code output
     bool bZchangeG53;
     bool nom6; // missing m6
+    bool estimate_runtime;
 
     bool bTile;
 
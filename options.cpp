@@ -205,7 +205,9 @@ options::options()
         default_value(std::vector<CommaSeparated<string>>{{"millproject"}})->multitoken(),
         "list of comma-separated config files")
        ("help,?", "produce help message")
-       ("version,V", "show the current software version");
+       ("version,V", "show the current software version")
+       ("profile", po::value<string>()->implicit_value(""),
+        "print the wall time, CPU time, calls and peak memory of each stage when done.  If a filename is given, write them to it as JSON instead");
    po::options_description drilling_options("Drilling options, for making holes in the PCB");
 
    drilling_options.add_options()
@@ -292,7 +294,12 @@ options::options()
        ("eulerian-paths", po::value<bool>()->default_value(true)->implicit_value(true), "Don't mill the same path twice if milling loops overlap.  This can save up to 50% of milling time.  Enabled by default.")
        ("vectorial", po::value<bool>()->default_value(true)->implicit_value(true), "enable or disable the vectorial rendering engine")
        ("tsp-2opt", po::value<bool>()->default_value(true)->implicit_value(true), "use TSP 2OPT to find a faster toolpath (but slows down gcode generation)")
+       ("tsp-2opt-neighbours", po::value<size_t>()->default_value(0), "when using tsp-2opt, only try connecting each path to this many of its nearest neighbours, which is much faster on large boards; 0 to try all of them")
+       ("tsp-time-limit", po::value<double>()->default_value(0), "seconds to spend on each layer and drill improving the toolpath order further with Or-opt and 3-opt after tsp-2opt; more makes a faster gcode path, 0 to disable")
+       ("merge-near-points-grid", po::value<bool>()->default_value(false)->implicit_value(true), "merge nearly-touching points in the input with a grid instead of a sorted map; faster on large boards and finds every merge, but the output may differ slightly")
        ("path-finding-limit", po::value<size_t>()->default_value(1), "Use path finding for up to this many steps in the search (more is slower but makes a faster gcode path)")
+       ("threads", po::value<unsigned int>()->default_value(1), "number of threads to use for computing toolpaths, 0 to use all available cores")
+       ("voronoi-tiles", po::value<unsigned int>()->default_value(1), "split each layer into this many rows and columns of tiles for computing the voronoi regions, so that large boards can use more threads; 1 to compute each layer at once")
        ("g0-vertical-speed", po::value<Velocity>()->default_value(parse_unit<Velocity>("50in/min")), "speed of vertical G0 movements, for use in path-finding")
        ("g0-horizontal-speed", po::value<Velocity>()->default_value(parse_unit<Velocity>("100in/min")), "speed of horizontal G0 movements, for use in path-finding")
        ("backtrack", po::value<Velocity>()->default_value(std::numeric_limits<double>::infinity()), "allow retracing a milled path if it's faster than retract-move-lower.  For example, set to 5in/s if you are willing to remill 5 inches of trace in order to save 1 second of milling time.");
@@ -336,7 +343,9 @@ options::options()
        ("zchange", po::value<Length>(), "tool changing height")
        ("zchange-absolute", po::value<bool>()->default_value(false)->implicit_value(true), "use zchange as a machine coordinates height (G53)")
        ("tile-x", po::value<int>()->default_value(1), "number of tiling columns. Default value is 1")
-       ("tile-y", po::value<int>()->default_value(1), "number of tiling rows. Default value is 1");
+       ("tile-y", po::value<int>()->default_value(1), "number of tiling rows. Default value is 1")
+       ("estimate-runtime", po::value<bool>()->default_value(false)->implicit_value(true),
+        "write the estimated milling time of each layer, from the feeds and g0 speeds, in the gcode header");
    cfg_options.add(cnc_options);
 
    cfg_options.add_options()
@@ -348,6 +357,7 @@ options::options()
        ("tolerance", po::value<double>(), "maximum toolpath tolerance")
        ("nog64", po::value<bool>()->default_value(false)->implicit_value(true), "do not set an explicit g64")
        ("output-dir", po::value<string>()->default_value(""), "output directory")
+       ("cache-dir", po::value<string>()->default_value(""), "existing directory for keeping rendered layers and toolpaths between runs, so that changing only the G-code output options doesn't compute the toolpaths again; empty to disable")
        ("basename", po::value<string>(), "prefix for default output file names")
        ("preamble-text", po::value<string>(), "preamble text file, inserted at the very beginning as a comment.")
        ("preamble", po::value<string>(), "gcode preamble file, inserted at the very beginning.")
@@ -484,6 +494,16 @@ static void check_generic_parameters(po::variables_map const& vm)
         vm["tsp-2opt"].as<bool>()) {
       options::maybe_throw("Error: Can't use tsp-2opt together with mill-feed-direction", ERR_INVALIDPARAMETER);
     }
+    if (vm["voronoi-tiles"].as<unsigned int>() == 0) {
+      options::maybe_throw("Error: voronoi-tiles must be at least 1", ERR_INVALIDPARAMETER);
+    }
+    if (vm["tsp-time-limit"].as<double>() < 0) {
+      options::maybe_throw("Error: tsp-time-limit can't be negative", ERR_INVALIDPARAMETER);
+    }
+    if (vm["mill-feed-direction"].as<MillFeedDirection::MillFeedDirection>() != MillFeedDirection::ANY &&
+        vm["tsp-time-limit"].as<double>() > 0) {
+      options::maybe_throw("Error: Can't use tsp-time-limit together with mill-feed-direction", ERR_INVALIDPARAMETER);
+    }
 }
 
 /******************************************************************************/
@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <limits>
+#include <vector>
+using std::vector;
+
+#include <utility>
+using std::pair;
+using std::make_pair;
+
+#include <boost/optional.hpp>
+using boost::optional;
+
+#include "path_connections.hpp"
+
+namespace path_connections {
+
+namespace bgi = boost::geometry::index;
+
+ConnectionFinder::ConnectionFinder(const vector<pair<linestring_type_fp, bool>>& paths,
+                                   coordinate_type_fp max_distance) :
+    paths(paths),
+    max_distance(max_distance),
+    candidates(paths.size() * 2) {
+  vector<endpoint_t> all_endpoints;
+  all_endpoints.reserve(paths.size() * 2);
+  for (size_t i = 0; i < paths.size(); i++) {
+    all_endpoints.emplace_back(paths[i].first.front(), i * 2);
+    all_endpoints.emplace_back(paths[i].first.back(), i * 2 + 1);
+  }
+  // Constructing from a range uses packing, which is faster than
+  // inserting one at a time and makes a better tree.
+  endpoints = decltype(endpoints)(all_endpoints);
+  for (size_t endpoint = 0; endpoint < all_endpoints.size(); endpoint++) {
+    push_next(endpoint);
+  }
+}
+
+optional<Connection> ConnectionFinder::make_connection(size_t from, size_t to) const {
+  const size_t from_path = path_index(from);
+  const size_t to_path = path_index(to);
+  const auto& from_ls = paths[from_path].first;
+  const auto& to_ls = paths[to_path].first;
+  const auto distance = bg::distance(is_back(from) ? from_ls.back() : from_ls.front(),
+                                     is_back(to) ? to_ls.back() : to_ls.front());
+  if (is_back(from) != is_back(to)) {
+    return Connection{distance, from_ls.back(), to_ls.front(), from_path, to_path};
+  }
+  if (!is_back(from) && paths[from_path].second) {
+    // The from path is reversible so we can connect from the front of it.
+    return Connection{distance, from_ls.front(), to_ls.front(), from_path, to_path};
+  }
+  if (is_back(from) && paths[to_path].second) {
+    // The to path is reversible so we can connect to the back of it.
+    return Connection{distance, from_ls.back(), to_ls.back(), from_path, to_path};
+  }
+  return boost::none;
+}
+
+bool ConnectionFinder::refill(size_t endpoint) {
+  auto& c = candidates[endpoint];
+  c.connections.clear();
+  c.next_index = 0;
+  const auto& path = paths[path_index(endpoint)].first;
+  const auto& point = is_back(endpoint) ? path.back() : path.front();
+  while (!c.exhausted) {
+    vector<endpoint_t> found;
+    endpoints.query(
+        bgi::nearest(point, c.batch_size) &&
+        bgi::satisfies([&](const endpoint_t& other) {
+            return path_index(other.second) > path_index(endpoint) &&
+                make_connection(endpoint, other.second);
+          }),
+        std::back_inserter(found));
+    if (found.size() < c.batch_size) {
+      c.exhausted = true;
+    }
+    for (const auto& other : found) {
+      auto connection = *make_connection(endpoint, other.second);
+      if (connection.distance > c.found_distance) {
+        c.connections.push_back(connection);
+      }
+    }
+    std::sort(c.connections.begin(), c.connections.end());
+    if (!c.exhausted && !c.connections.empty()) {
+      // There might be more endpoints at the same distance as the
+      // farthest ones that weren't found so don't use those yet.
+      const auto farthest = c.connections.back().distance;
+      while (!c.connections.empty() && c.connections.back().distance == farthest) {
+        c.connections.pop_back();
+      }
+    }
+    while (!c.connections.empty() && c.connections.back().distance > max_distance) {
+      // Everything else will be even farther.
+      c.connections.pop_back();
+      c.exhausted = true;
+    }
+    c.batch_size *= 2;
+    if (!c.connections.empty()) {
+      c.found_distance = c.connections.back().distance;
+      return true;
+    }
+  }
+  return false;
+}
+
+void ConnectionFinder::push_next(size_t endpoint) {
+  auto& c = candidates[endpoint];
+  if (c.next_index == c.connections.size() && !refill(endpoint)) {
+    return;
+  }
+  closest.emplace(c.connections[c.next_index], endpoint);
+  c.next_index++;
+}
+
+optional<Connection> ConnectionFinder::next() {
+  if (closest.empty()) {
+    return boost::none;
+  }
+  const auto top = closest.top();
+  closest.pop();
+  push_next(top.second);
+  return top.first;
+}
+
+EndpointIndex::EndpointIndex(const vector<pair<linestring_type_fp, bool>>& paths,
+                             coordinate_type_fp max_distance) :
+    paths(paths),
+    max_distance(max_distance) {
+  add();
+}
+
+void EndpointIndex::add() {
+  for (size_t i = indexed.size(); i < paths.size(); i++) {
+    const auto& path = paths[i].first;
+    indexed.emplace_back(path.front(), path.back());
+    endpoints.insert(endpoint_t(path.front(), i));
+    endpoints.insert(endpoint_t(path.back(), i));
+  }
+}
+
+void EndpointIndex::update(size_t path) {
+  endpoints.remove(endpoint_t(indexed[path].first, path));
+  endpoints.remove(endpoint_t(indexed[path].second, path));
+  indexed[path] = make_pair(paths[path].first.front(), paths[path].first.back());
+  endpoints.insert(endpoint_t(indexed[path].first, path));
+  endpoints.insert(endpoint_t(indexed[path].second, path));
+}
+
+vector<size_t> EndpointIndex::near(const box_type_fp& box) const {
+  vector<size_t> ret;
+  if (std::isinf(max_distance)) {
+    for (size_t i = 0; i < indexed.size(); i++) {
+      ret.push_back(i);
+    }
+    return ret;
+  }
+  const box_type_fp search_box(
+      point_type_fp(box.min_corner().x() - max_distance, box.min_corner().y() - max_distance),
+      point_type_fp(box.max_corner().x() + max_distance, box.max_corner().y() + max_distance));
+  vector<endpoint_t> found;
+  endpoints.query(
+      bgi::intersects(search_box) &&
+      bgi::satisfies([&](const endpoint_t& endpoint) {
+          return bg::distance(endpoint.first, box) <= max_distance;
+        }),
+      std::back_inserter(found));
+  for (const auto& endpoint : found) {
+    ret.push_back(endpoint.second);
+  }
+  std::sort(ret.begin(), ret.end());
+  ret.erase(std::unique(ret.begin(), ret.end()), ret.end());
+  return ret;
+}
+
+} // namespace path_connections
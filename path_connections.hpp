@@ -0,0 +1,121 @@
+#ifndef PATH_CONNECTIONS_HPP
+#define PATH_CONNECTIONS_HPP
+
+#include <queue>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <boost/geometry/index/rtree.hpp>
+#include <boost/optional.hpp>
+
+#include "geometry.hpp"
+#include "bg_operators.hpp"
+
+namespace path_connections {
+
+// A possible connection from the endpoint of one path to the endpoint
+// of another path.  start is on paths[start_path] and end is on
+// paths[end_path] and start_path < end_path.
+struct Connection {
+  coordinate_type_fp distance;
+  point_type_fp start;
+  point_type_fp end;
+  size_t start_path;
+  size_t end_path;
+
+  bool operator<(const Connection& other) const {
+    return std::tie(distance, start, end, start_path, end_path) <
+        std::tie(other.distance, other.start, other.end, other.start_path, other.end_path);
+  }
+};
+
+// Given paths, each with a bool that is true if the path is
+// reversible, find all the connections that could be made between
+// them, from closest to farthest.  For paths i < j, these are
+// considered:
+//
+//   back of i to front of j, always.
+//   front of i to front of j, if i is reversible.
+//   back of i to back of j, if j is reversible.
+//
+// The distance between the front of i and the back of j is also
+// yielded as a connection from the back of i to the front of j.  This
+// is the order in which connections have always been tried so it's
+// kept for compatibility.
+//
+// The connections are found lazily using a spatial index of the
+// endpoints so memory use is linear in the number of paths.
+// Connections longer than max_distance are never returned.  The order
+// is exactly that of sorting all the connections.
+class ConnectionFinder {
+ public:
+  ConnectionFinder(const std::vector<std::pair<linestring_type_fp, bool>>& paths,
+                   coordinate_type_fp max_distance);
+  // Returns the next closest connection or none if there are no more.
+  boost::optional<Connection> next();
+
+ private:
+  typedef std::pair<point_type_fp, size_t> endpoint_t;
+  // For each endpoint, the connections to endpoints that haven't yet
+  // been returned, sorted.  They are searched in batches of
+  // increasing size.
+  struct Candidates {
+    size_t batch_size = 4;
+    bool exhausted = false;
+    // Every connection up to and including this distance has already
+    // been found.
+    coordinate_type_fp found_distance = -1;
+    std::vector<Connection> connections;
+    size_t next_index = 0;
+  };
+
+  // The path that an endpoint is on and whether it's the back.
+  static size_t path_index(size_t endpoint) { return endpoint / 2; }
+  static bool is_back(size_t endpoint) { return endpoint % 2 == 1; }
+  // Returns the connection, if any, that is made for the two endpoints.
+  boost::optional<Connection> make_connection(size_t from, size_t to) const;
+  // Find more connections for the endpoint.  Returns false if there
+  // are none left.
+  bool refill(size_t endpoint);
+  void push_next(size_t endpoint);
+
+  const std::vector<std::pair<linestring_type_fp, bool>>& paths;
+  const coordinate_type_fp max_distance;
+  boost::geometry::index::rtree<endpoint_t, boost::geometry::index::quadratic<16>> endpoints;
+  std::vector<Candidates> candidates;
+  std::priority_queue<std::pair<Connection, size_t>,
+                      std::vector<std::pair<Connection, size_t>>,
+                      std::greater<std::pair<Connection, size_t>>> closest;
+};
+
+// The front and back of each of the paths, for finding the paths
+// that might be connected to a place without looking at all of them.
+// The paths may grow: call add after appending to them and update
+// after changing the endpoints of one of them.
+class EndpointIndex {
+ public:
+  // Only endpoints within max_distance are ever returned.
+  EndpointIndex(const std::vector<std::pair<linestring_type_fp, bool>>& paths,
+                coordinate_type_fp max_distance);
+  // Index the paths that were appended since the last call.
+  void add();
+  // Index the new endpoints of paths[path].
+  void update(size_t path);
+  // The paths with an endpoint no more than max_distance from the
+  // box, in increasing order.
+  std::vector<size_t> near(const box_type_fp& box) const;
+
+ private:
+  typedef std::pair<point_type_fp, size_t> endpoint_t;
+
+  const std::vector<std::pair<linestring_type_fp, bool>>& paths;
+  const coordinate_type_fp max_distance;
+  boost::geometry::index::rtree<endpoint_t, boost::geometry::index::quadratic<16>> endpoints;
+  // The front and back of each path as they are in endpoints.
+  std::vector<std::pair<point_type_fp, point_type_fp>> indexed;
+};
+
+} // namespace path_connections
+
+#endif //PATH_CONNECTIONS_HPP
@@ -0,0 +1,155 @@
+#define BOOST_TEST_MODULE path connections tests
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "geometry.hpp"
+#include "bg_operators.hpp"
+#include "path_connections.hpp"
+
+using namespace std;
+using path_connections::Connection;
+using path_connections::ConnectionFinder;
+
+// All the connections, found by brute force.
+vector<Connection> all_connections(const vector<pair<linestring_type_fp, bool>>& paths,
+                                   coordinate_type_fp max_distance) {
+  vector<Connection> connections;
+  for (size_t i = 0; i < paths.size(); i++) {
+    const auto& path1 = paths[i];
+    for (size_t j = i+1; j < paths.size(); j++) {
+      const auto& path2 = paths[j];
+      connections.push_back({bg::distance(path1.first.back(), path2.first.front()),
+                             path1.first.back(), path2.first.front(), i, j});
+      connections.push_back({bg::distance(path1.first.front(), path2.first.back()),
+                             path1.first.back(), path2.first.front(), i, j});
+      if (path1.second) {
+        connections.push_back({bg::distance(path1.first.front(), path2.first.front()),
+                               path1.first.front(), path2.first.front(), i, j});
+      }
+      if (path2.second) {
+        connections.push_back({bg::distance(path1.first.back(), path2.first.back()),
+                               path1.first.back(), path2.first.back(), i, j});
+      }
+    }
+  }
+  connections.erase(std::remove_if(connections.begin(), connections.end(),
+                                   [&](const Connection& c) { return c.distance > max_distance; }),
+                    connections.end());
+  std::sort(connections.begin(), connections.end());
+  return connections;
+}
+
+vector<Connection> found_connections(const vector<pair<linestring_type_fp, bool>>& paths,
+                                     coordinate_type_fp max_distance) {
+  vector<Connection> connections;
+  ConnectionFinder finder(paths, max_distance);
+  while (auto connection = finder.next()) {
+    connections.push_back(*connection);
+  }
+  return connections;
+}
+
+void check_connections(const vector<pair<linestring_type_fp, bool>>& paths,
+                       coordinate_type_fp max_distance) {
+  const auto expected = all_connections(paths, max_distance);
+  const auto actual = found_connections(paths, max_distance);
+  BOOST_REQUIRE_EQUAL(actual.size(), expected.size());
+  for (size_t i = 0; i < expected.size(); i++) {
+    BOOST_CHECK(!(actual[i] < expected[i]) && !(expected[i] < actual[i]));
+  }
+}
+
+vector<pair<linestring_type_fp, bool>> random_paths(size_t count, int grid, unsigned int seed) {
+  std::mt19937 gen(seed);
+  std::uniform_int_distribution<int> coordinate(0, grid);
+  std::bernoulli_distribution reversible(0.5);
+  vector<pair<linestring_type_fp, bool>> paths;
+  for (size_t i = 0; i < count; i++) {
+    paths.push_back({{{double(coordinate(gen)), double(coordinate(gen))},
+                      {double(coordinate(gen)), double(coordinate(gen))}},
+                     reversible(gen)});
+  }
+  return paths;
+}
+
+BOOST_AUTO_TEST_SUITE(path_connections_tests)
+
+BOOST_AUTO_TEST_CASE(empty) {
+  vector<pair<linestring_type_fp, bool>> paths;
+  BOOST_CHECK(found_connections(paths, 10).empty());
+}
+
+BOOST_AUTO_TEST_CASE(one_path) {
+  vector<pair<linestring_type_fp, bool>> paths{{{{0, 0}, {1, 1}}, true}};
+  BOOST_CHECK(found_connections(paths, 10).empty());
+}
+
+BOOST_AUTO_TEST_CASE(two_paths) {
+  vector<pair<linestring_type_fp, bool>> paths{
+    {{{0, 0}, {1, 0}}, false},
+    {{{3, 0}, {2, 0}}, true},
+  };
+  const auto connections = found_connections(paths, 10);
+  BOOST_REQUIRE_EQUAL(connections.size(), 3);
+  BOOST_CHECK_EQUAL(connections[0].start, point_type_fp(1, 0));
+  BOOST_CHECK_EQUAL(connections[0].end, point_type_fp(2, 0));
+  BOOST_CHECK_EQUAL(connections[0].distance, 1);
+  check_connections(paths, 10);
+}
+
+BOOST_AUTO_TEST_CASE(max_distance) {
+  check_connections(random_paths(50, 100, 1), 20);
+  check_connections(random_paths(50, 100, 2), 0);
+}
+
+// Lots of points on a small grid so that there are many ties.
+BOOST_AUTO_TEST_CASE(ties) {
+  for (unsigned int seed = 0; seed < 10; seed++) {
+    check_connections(random_paths(100, 5, seed), std::numeric_limits<double>::infinity());
+  }
+}
+
+BOOST_AUTO_TEST_CASE(random) {
+  for (unsigned int seed = 0; seed < 5; seed++) {
+    check_connections(random_paths(200, 1000, seed), std::numeric_limits<double>::infinity());
+  }
+}
+
+// The endpoint index finds the same paths as checking all of them,
+// also after paths are added and changed.
+BOOST_AUTO_TEST_CASE(endpoint_index) {
+  auto paths = random_paths(50, 100, 3);
+  path_connections::EndpointIndex endpoints(paths, 10);
+  std::mt19937 gen(4);
+  std::uniform_int_distribution<int> coordinate(0, 100);
+  for (size_t i = 0; i < 200; i++) {
+    const point_type_fp p(coordinate(gen), coordinate(gen));
+    const box_type_fp box(p, point_type_fp(p.x() + coordinate(gen) / 10, p.y() + coordinate(gen) / 10));
+    vector<size_t> expected;
+    for (size_t j = 0; j < paths.size(); j++) {
+      if (bg::distance(paths[j].first.front(), box) <= 10 ||
+          bg::distance(paths[j].first.back(), box) <= 10) {
+        expected.push_back(j);
+      }
+    }
+    BOOST_CHECK(endpoints.near(box) == expected);
+    // Alternate between growing a path and adding one.
+    if (i % 2 == 0) {
+      auto& path = paths[i % paths.size()].first;
+      path.push_back(p);
+      bg::reverse(path);
+      endpoints.update(i % paths.size());
+    } else {
+      paths.push_back({{p, box.max_corner()}, true});
+      endpoints.add();
+    }
+  }
+  path_connections::EndpointIndex everything(paths, std::numeric_limits<double>::infinity());
+  BOOST_CHECK_EQUAL(everything.near(box_type_fp({0, 0}, {0, 0})).size(), paths.size());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -4,12 +4,9 @@ using std::vector;
 #include <unordered_map>
 using std::unordered_map;
 
-#include <unordered_set>
-using std::unordered_set;
-
-#include <queue>
-using std::priority_queue;
-
+#include <algorithm>
+#include <cstdint>
+#include <limits>
 #include <utility>
 using std::pair;
 using std::make_pair;
@@ -24,6 +21,7 @@ using std::make_pair;
 #include "bg_operators.hpp"
 #include "bg_helpers.hpp"
 #include "segment_tree.hpp"
+#include "profile.hpp"
 
 namespace path_finding {
 
@@ -36,7 +34,7 @@ Neighbors::iterator Neighbors::iterator::operator++() {
     // Move to a new valid point, even if it isn't a neighbor.
     point_index++;
   } while (point_index < all_vertices_size + 2 &&
-           !neighbors->is_neighbor(**this));
+           !neighbors->is_neighbor(point_index));
   return *this;
 }
 
@@ -49,37 +47,57 @@ bool Neighbors::iterator::operator==(const Neighbors::iterator& other) const {
 }
 
 const point_type_fp& Neighbors::iterator::operator*() const {
-  if (point_index == 0) {
-    return neighbors->start;
-  } else if (point_index == 1) {
-    return neighbors->goal;
-  } else {
-    return neighbors->vertices[point_index-2];
-  }
+  return neighbors->point(point_index);
 }
 
 Neighbors::Neighbors(const point_type_fp& start, const point_type_fp& goal,
                      const point_type_fp& current,
                      const coordinate_type_fp& max_path_length,
                      const std::vector<point_type_fp>& vertices,
-                     const PathFindingSurface* pfs) :
+                     std::atomic<uint8_t>* visibility,
+                     const PathFindingSurface* pfs,
+                     boost::optional<size_t>& tries) :
     start(start),
     goal(goal),
     current(current),
     max_path_length_squared(max_path_length),
     vertices(vertices),
-    pfs(pfs) {}
+    visibility(visibility),
+    pfs(pfs),
+    tries(tries) {}
+
+const point_type_fp& Neighbors::point(size_t point_index) const {
+  if (point_index == 0) {
+    return start;
+  } else if (point_index == 1) {
+    return goal;
+  } else {
+    return vertices[point_index-2];
+  }
+}
 
 // Returns a valid neighbor index that is either the one provided or
 // the next higher valid one.
-inline bool Neighbors::is_neighbor(const point_type_fp p) const {
+inline bool Neighbors::is_neighbor(size_t point_index) const {
+  const auto& p = point(point_index);
   if (p == current) {
     return false;
   }
-  pfs->decrement_tries();
+  PathFindingSurface::decrement_tries(tries);
   if (bg::distance(current, p) + bg::distance(p, goal) > max_path_length_squared) {
     return false;
   }
+  if (visibility && point_index >= 2) {
+    // Other threads might be filling in the same entry but they'll
+    // all write the same value.
+    auto& entry = visibility[point_index - 2];
+    uint8_t visible = entry.load(std::memory_order_relaxed);
+    if (visible == 0) {
+      visible = pfs->segment_in_surface(current, p) ? 1 : 2;
+      entry.store(visible, std::memory_order_relaxed);
+    }
+    return visible == 1;
+  }
   if (!pfs->in_surface(current, p)) {
     return false;
   }
@@ -92,7 +110,7 @@ Neighbors::iterator Neighbors::begin() const {
     // Can't dereferfence the end.
     return ret;
   }
-  if (is_neighbor(*ret)) {
+  if (is_neighbor(0)) {
     // This is a valid begin.
     return ret;
   } else {
@@ -144,7 +162,9 @@ vector<vector<std::reference_wrapper<const ring_type_fp>>> get_all_rings(
 
 PathFindingSurface::PathFindingSurface(const optional<multi_polygon_type_fp>& keep_in,
                                        const multi_polygon_type_fp& keep_out,
-                                       const coordinate_type_fp tolerance) {
+                                       const coordinate_type_fp tolerance) :
+    memo_mutex(new std::mutex) {
+  profile::Timer timer("PathFindingSurface");
   if (keep_in) {
     multi_polygon_type_fp total_keep_in = *keep_in - keep_out;
 
@@ -330,16 +350,25 @@ boost::optional<RingIndices> outside_multipolygons(
    rings in the stored polygon should be used for the generated points
    in the path and also for the collision detection. */
 const boost::optional<SearchKey>& PathFindingSurface::in_surface(point_type_fp p) const {
-  auto memoized_result = point_in_surface_memo.find(p);
-  if (memoized_result != point_in_surface_memo.cend()) {
-    return memoized_result->second;
+  // References into an unordered_map remain valid after insertion so
+  // it's safe to return them after the lock is released.
+  {
+    std::lock_guard<std::mutex> lock(*memo_mutex);
+    auto memoized_result = point_in_surface_memo.find(p);
+    if (memoized_result != point_in_surface_memo.cend()) {
+      return memoized_result->second;
+    }
   }
+  // This is the slow part so it's done without the lock.  Another
+  // thread might do the same point at the same time and the first one
+  // to insert it wins.
   boost::optional<RingIndices> maybe_ring_indices;
   if (total_keep_in_grown) {
     maybe_ring_indices = inside_multipolygons(p, *total_keep_in_grown);
   } else {
     maybe_ring_indices = outside_multipolygons(p, keep_out_shrunk);
   }
+  std::lock_guard<std::mutex> lock(*memo_mutex);
   if (!maybe_ring_indices) {
     return point_in_surface_memo.emplace(p, boost::none).first->second;
   }
@@ -356,7 +385,7 @@ const boost::optional<SearchKey>& PathFindingSurface::in_surface(point_type_fp p
   return point_in_surface_memo.emplace(p, ring_indices_cache.size()-1).first->second;
 }
 
-void PathFindingSurface::decrement_tries() const {
+void PathFindingSurface::decrement_tries(boost::optional<size_t>& tries) {
   if (tries) {
     if (*tries == 0) {
       throw GiveUp();
@@ -372,13 +401,65 @@ bool PathFindingSurface::in_surface(
     return in_surface(b, a);
   }
   const auto key = make_pair(a, b);
-  auto memoized_result = edge_in_surface_memo.find(key);
-  if (memoized_result != edge_in_surface_memo.cend()) {
-    return memoized_result->second;
+  {
+    std::lock_guard<std::mutex> lock(*memo_mutex);
+    auto memoized_result = edge_in_surface_memo.find(key);
+    if (memoized_result != edge_in_surface_memo.cend()) {
+      return memoized_result->second;
+    }
+  }
+  const auto result = segment_in_surface(a, b);
+  std::lock_guard<std::mutex> lock(*memo_mutex);
+  edge_in_surface_memo.emplace(key, result);
+  return result;
+}
+
+bool PathFindingSurface::segment_in_surface(
+    const point_type_fp& a, const point_type_fp& b) const {
+  if (b < a) {
+    return segment_in_surface(b, a);
+  }
+  // The tree is never modified so this is safe to do without the lock.
+  return !tree.intersects(a, b);
+}
+
+// The most entries in all the rows of the visibility graphs of a
+// surface, so that the memory used stays reasonable.
+static const size_t max_visibility_size = 64 * 1024 * 1024;
+
+PathFindingSurface::VisibilityGraph& PathFindingSurface::visibility_graph(
+    SearchKey search_key, const std::vector<point_type_fp>& search_vertices) const {
+  auto& graph = visibility_memo[search_key];
+  if (graph.first_index.size() != search_vertices.size()) {
+    graph.rows.resize(search_vertices.size());
+    graph.first_index.reserve(search_vertices.size());
+    for (size_t i = 0; i < search_vertices.size(); i++) {
+      // Duplicate vertices all use the first one's row.
+      graph.first_index.push_back(graph.vertex_index.emplace(search_vertices[i], i).first->second);
+    }
   }
-  auto found_intersection = tree.intersects(a, b);
-  edge_in_surface_memo.emplace(key, !found_intersection);
-  return !found_intersection;
+  return graph;
+}
+
+std::atomic<uint8_t>* PathFindingSurface::visibility_row(SearchKey search_key,
+                                                         const point_type_fp& p) const {
+  const auto& search_vertices = vertices(search_key);
+  std::lock_guard<std::mutex> lock(*memo_mutex);
+  auto& graph = visibility_graph(search_key, search_vertices);
+  const auto found = graph.vertex_index.find(p);
+  if (found == graph.vertex_index.cend()) {
+    return nullptr;
+  }
+  auto& row = graph.rows[found->second];
+  if (!row) {
+    if (visibility_size + search_vertices.size() > max_visibility_size) {
+      return nullptr;
+    }
+    // The () makes them all start at 0.
+    row.reset(new std::atomic<uint8_t>[search_vertices.size()]());
+    visibility_size += search_vertices.size();
+  }
+  return row.get();
 }
 
 // Return all possible neighbors of current.  A neighbor can be
@@ -387,33 +468,141 @@ bool PathFindingSurface::in_surface(
 Neighbors PathFindingSurface::neighbors(const point_type_fp& start, const point_type_fp& goal,
                                         const coordinate_type_fp& max_path_length,
                                         SearchKey search_key,
-                                        const point_type_fp& current) const {
-  return Neighbors(start, goal, current, max_path_length, vertices(search_key), this);
+                                        const point_type_fp& current,
+                                        boost::optional<size_t>& tries) const {
+  return Neighbors(start, goal, current, max_path_length, vertices(search_key),
+                   visibility_row(search_key, current), this, tries);
 }
 
-// Return a path from the start to the current.  Always return at
-// least two points.
-linestring_type_fp build_path(
-    point_type_fp current,
-    const unordered_map<point_type_fp, point_type_fp>& came_from) {
-  linestring_type_fp result;
-  while (came_from.count(current)) {
-    result.push_back(current);
-    current = came_from.at(current);
-  }
-  result.push_back(current);
-  bg::reverse(result);
-  return result;
-}
+namespace {
+
+// The state of an A* search over nodes numbered from 0: the g-scores,
+// where each node came from and the open set, which is a binary heap
+// with decrease-key.  It's kept between the searches on a thread and
+// nodes are marked with the generation of the search that last saw
+// them, so a search doesn't have to allocate or clear anything.
+class AStarScratch {
+ public:
+  static const size_t none = std::numeric_limits<size_t>::max();
+
+  // Start a new search with node_count nodes, all unseen.
+  void reset(size_t node_count) {
+    if (stamp.size() < node_count) {
+      stamp.resize(node_count, 0);
+      g_scores.resize(node_count);
+      f_scores.resize(node_count);
+      parents.resize(node_count);
+      heap_position.resize(node_count);
+    }
+    // Seen nodes are stamped with the generation, closed ones with
+    // the generation + 1.
+    generation += 2;
+    if (generation == 0) {
+      std::fill(stamp.begin(), stamp.end(), 0);
+      generation = 2;
+    }
+    heap.clear();
+  }
+  bool seen(size_t node) const { return stamp[node] >= generation; }
+  bool closed(size_t node) const { return stamp[node] == generation + 1; }
+  void close(size_t node) { stamp[node] = generation + 1; }
+  coordinate_type_fp g_score(size_t node) const { return g_scores[node]; }
+  coordinate_type_fp f_score(size_t node) const { return f_scores[node]; }
+  size_t came_from(size_t node) const { return parents[node]; }
+  void set(size_t node, coordinate_type_fp g_score, size_t came_from) {
+    if (!seen(node)) {
+      stamp[node] = generation;
+      heap_position[node] = none;
+    }
+    g_scores[node] = g_score;
+    parents[node] = came_from;
+  }
+
+  // Add the node to the open set or lower its f-score if it's
+  // already there.  before(a, b) is true if a should be popped
+  // before b.  The node must have been set.
+  template <typename Before>
+  void push(size_t node, coordinate_type_fp f_score, const Before& before) {
+    f_scores[node] = f_score;
+    if (heap_position[node] == none) {
+      heap_position[node] = heap.size();
+      heap.push_back(node);
+    }
+    sift_up(heap_position[node], before);
+  }
+  bool empty() const { return heap.empty(); }
+  template <typename Before>
+  size_t pop(const Before& before) {
+    const size_t top = heap.front();
+    heap_position[top] = none;
+    heap.front() = heap.back();
+    heap.pop_back();
+    if (!heap.empty()) {
+      heap_position[heap.front()] = 0;
+      sift_down(0, before);
+    }
+    return top;
+  }
+
+ private:
+  template <typename Before>
+  void sift_up(size_t position, const Before& before) {
+    const size_t node = heap[position];
+    while (position > 0) {
+      const size_t parent = (position - 1) / 2;
+      if (!before(node, heap[parent])) {
+        break;
+      }
+      heap[position] = heap[parent];
+      heap_position[heap[position]] = position;
+      position = parent;
+    }
+    heap[position] = node;
+    heap_position[node] = position;
+  }
+  template <typename Before>
+  void sift_down(size_t position, const Before& before) {
+    const size_t node = heap[position];
+    while (true) {
+      size_t child = position * 2 + 1;
+      if (child >= heap.size()) {
+        break;
+      }
+      if (child + 1 < heap.size() && before(heap[child + 1], heap[child])) {
+        child++;
+      }
+      if (!before(heap[child], node)) {
+        break;
+      }
+      heap[position] = heap[child];
+      heap_position[heap[position]] = position;
+      position = child;
+    }
+    heap[position] = node;
+    heap_position[node] = position;
+  }
+
+  uint32_t generation = 0;
+  std::vector<uint32_t> stamp;
+  std::vector<coordinate_type_fp> g_scores;
+  std::vector<coordinate_type_fp> f_scores;
+  std::vector<size_t> parents;
+  std::vector<size_t> heap_position;
+  std::vector<size_t> heap;
+};
+
+} // namespace
+
 optional<linestring_type_fp> PathFindingSurface::find_path(
     const point_type_fp& start, const point_type_fp& goal,
     const coordinate_type_fp& max_path_length,
-    SearchKey search_key) const {
+    SearchKey search_key,
+    boost::optional<size_t>& tries) const {
   // Connect if a direct connection is possible.  This also takes care
   // of the case where start == goal.
   try {
     if (in_surface(start, goal)) {
-      decrement_tries();
+      decrement_tries(tries);
       if (bg::comparable_distance(start, goal) < max_path_length * max_path_length) {
         // in_surface builds up some structures that are only efficient if
         // we're doing many tries.
@@ -426,47 +615,81 @@ optional<linestring_type_fp> PathFindingSurface::find_path(
   } catch (GiveUp g) {
     return boost::none;
   }
-  // Do astar.
-  priority_queue<pair<coordinate_type_fp, point_type_fp>,
-                 vector<pair<coordinate_type_fp, point_type_fp>>,
-                 std::greater<pair<coordinate_type_fp, point_type_fp>>> open_set;
-  open_set.emplace(bg::distance(start, goal), start);
-  unordered_set<point_type_fp> closed_set;
-  unordered_map<point_type_fp, point_type_fp> came_from;
-  unordered_map<point_type_fp, coordinate_type_fp> g_score; // Empty should be considered infinity.
-  g_score[start] = 0;
-  while (!open_set.empty()) {
-    const auto current = open_set.top().second;
-    open_set.pop();
-    if (current == goal) {
-      // We're done.
-      return boost::make_optional(build_path(current, came_from));
+  // Do astar.  The nodes are the vertices, with duplicates using the
+  // first one, and then start and goal if they aren't vertices.
+  const auto& search_vertices = vertices(search_key);
+  const VisibilityGraph* graph;
+  {
+    std::lock_guard<std::mutex> lock(*memo_mutex);
+    // The graph is never moved and this part of it never changes so
+    // it's safe to use without the lock.
+    graph = &visibility_graph(search_key, search_vertices);
+  }
+  const size_t vertex_count = search_vertices.size();
+  const auto node_of = [&](const point_type_fp& p, size_t otherwise) {
+    const auto found = graph->vertex_index.find(p);
+    return found == graph->vertex_index.cend() ? otherwise : found->second;
+  };
+  const size_t start_node = node_of(start, vertex_count);
+  const size_t goal_node = goal == start ? start_node : node_of(goal, vertex_count + 1);
+  const auto point_of = [&](size_t node) -> const point_type_fp& {
+    if (node < vertex_count) {
+      return search_vertices[node];
     }
-    if (closed_set.count(current) > 0) {
-      // Skip this because we already "removed it", sort of.
-      continue;
+    return node == vertex_count ? start : goal;
+  };
+
+  thread_local AStarScratch scratch;
+  scratch.reset(vertex_count + 2);
+  // Ties in f-score are broken by the point so that the path found
+  // doesn't depend on the order of the vertices.
+  const auto before = [&](size_t a, size_t b) {
+    return scratch.f_score(a) < scratch.f_score(b) ||
+        (!(scratch.f_score(b) < scratch.f_score(a)) && point_of(a) < point_of(b));
+  };
+  scratch.set(start_node, 0, AStarScratch::none);
+  scratch.push(start_node, bg::distance(start, goal), before);
+  while (!scratch.empty()) {
+    const size_t current_node = scratch.pop(before);
+    const auto& current = point_of(current_node);
+    if (current_node == goal_node) {
+      // We're done.  The start is the only node that didn't come from
+      // another.
+      linestring_type_fp result;
+      for (size_t node = current_node; node != AStarScratch::none; node = scratch.came_from(node)) {
+        result.push_back(point_of(node));
+      }
+      bg::reverse(result);
+      return result;
     }
     try {
+      const auto current_g_score = scratch.g_score(current_node);
       const auto current_neighbors = neighbors(
           start, goal,
-          max_path_length - g_score.at(current),
+          max_path_length - current_g_score,
           search_key,
-          current);
-      for (const auto& neighbor : current_neighbors) {
-        const auto tentative_g_score = g_score.at(current) + bg::distance(current, neighbor);
-        if (g_score.count(neighbor) == 0 || tentative_g_score < g_score.at(neighbor)) {
+          current,
+          tries);
+      for (auto neighbor = current_neighbors.begin(); neighbor != current_neighbors.end(); ++neighbor) {
+        const size_t index = neighbor.index();
+        const size_t neighbor_node = index == 0 ? start_node :
+                                     index == 1 ? goal_node :
+                                     graph->first_index[index - 2];
+        const auto tentative_g_score = current_g_score + bg::distance(current, *neighbor);
+        if (!scratch.seen(neighbor_node) || tentative_g_score < scratch.g_score(neighbor_node)) {
           // This path to neighbor is better than any previous one.
-          came_from[neighbor] = current;
-          g_score[neighbor] = tentative_g_score;
-          open_set.emplace(tentative_g_score + bg::distance(neighbor, goal), neighbor);
+          scratch.set(neighbor_node, tentative_g_score, current_node);
+          // A closed node keeps the better path but isn't searched
+          // again.
+          if (!scratch.closed(neighbor_node)) {
+            scratch.push(neighbor_node, tentative_g_score + bg::distance(*neighbor, goal), before);
+          }
         }
       }
     } catch (GiveUp g) {
       return boost::none;
     }
-    // Because we can't delete from the open_set, we'll just marked
-    // items as closed and ignore them later.
-    closed_set.insert(current);
+    scratch.close(current_node);
   }
   return boost::none;
 }
@@ -476,29 +699,23 @@ optional<linestring_type_fp> PathFindingSurface::find_path(
     const coordinate_type_fp& max_path_length,
     const boost::optional<size_t>& max_tries,
     SearchKey search_key) const {
-  if (max_tries) {
-    if (*max_tries == 0) {
-      return boost::none;
-    }
-    tries.emplace(*max_tries);
-  } else {
-    tries = boost::none;
+  profile::Timer timer("find_path");
+  if (max_tries && *max_tries == 0) {
+    return boost::none;
   }
-  return find_path(start, goal, max_path_length, search_key);
+  auto tries = max_tries;
+  return find_path(start, goal, max_path_length, search_key, tries);
 }
 
 optional<linestring_type_fp> PathFindingSurface::find_path(
     const point_type_fp& start, const point_type_fp& goal,
     const coordinate_type_fp& max_path_length,
     const boost::optional<size_t>& max_tries) const {
-  if (max_tries) {
-    if (*max_tries == 0) {
-      return boost::none;
-    }
-    tries.emplace(*max_tries);
-  } else {
-    tries = boost::none;
+  profile::Timer timer("find_path");
+  if (max_tries && *max_tries == 0) {
+    return boost::none;
   }
+  auto tries = max_tries;
 
   auto ring_indices = in_surface(start);
   if (!ring_indices) {
@@ -509,18 +726,25 @@ optional<linestring_type_fp> PathFindingSurface::find_path(
     // Either goal is not in the surface or it's in a region unreachable by start.
     return boost::none;
   }
-  return find_path(start, goal, max_path_length, *ring_indices);
+  return find_path(start, goal, max_path_length, *ring_indices, tries);
 }
 
 const std::vector<point_type_fp>&
 PathFindingSurface::vertices(SearchKey search_key) const {
-  auto memoized_result = vertices_memo.find(search_key);
-  if (memoized_result != vertices_memo.cend()) {
-    return memoized_result->second;
+  const RingIndices* ring_indices_ptr;
+  {
+    std::lock_guard<std::mutex> lock(*memo_mutex);
+    auto memoized_result = vertices_memo.find(search_key);
+    if (memoized_result != vertices_memo.cend()) {
+      return memoized_result->second;
+    }
+    ring_indices_ptr = &ring_indices_cache.at(search_key);
   }
+  // The entry in the deque doesn't move so the vertices can be
+  // collected without the lock.
   std::vector<point_type_fp> ret;
   const auto& vertices = all_vertices;
-  const auto& ring_indices = ring_indices_cache.at(search_key);
+  const auto& ring_indices = *ring_indices_ptr;
   for (size_t poly_index = 0; poly_index < ring_indices.size() ; poly_index++) {
     // This is the poly to look at.
     const auto& poly_ring_index = ring_indices[poly_index];
@@ -532,7 +756,8 @@ PathFindingSurface::vertices(SearchKey search_key) const {
       ret.insert(ret.cend(), ring_vertices.cbegin(), ring_vertices.cend());
     }
   }
-  return vertices_memo.emplace(search_key, ret).first->second;
+  std::lock_guard<std::mutex> lock(*memo_mutex);
+  return vertices_memo.emplace(search_key, std::move(ret)).first->second;
 }
 
 } //namespace path_finding
@@ -2,9 +2,15 @@
 #define PATH_FINDING_H
 
 #include <boost/optional.hpp>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <unordered_map>
 
 #include "geometry.hpp"
+#include "batch_intersect.hpp"
 #include "bg_operators.hpp"
 #include "segment_tree.hpp"
 
@@ -81,25 +87,7 @@ class PathFindingSurface;
 
 // From: http://geomalgorithms.com/a03-_inclusion.html
 extern inline bool point_in_ring(const point_type_fp& point, const ring_type_fp& ring) {
-  int winding_number = 0;
-
-  // loop through all edges of the polygon
-  for (size_t i=0; i < ring.size()-1; i++) {
-    if (ring[i].y() <= point.y()) {                   // start y <= point.y
-      if (ring[i+1].y() > point.y()) {                // an upward crossing
-        if (is_left(ring[i], ring[i+1], point) > 0) { // point left of  edge
-          ++winding_number;                           // have a valid up intersect
-        }
-      }
-    } else {                                          // start y > point.y
-      if (ring[i+1].y() <= point.y()) {               // a downward crossing
-        if (is_left(ring[i], ring[i+1], point) < 0) { // P right of  edge
-          --winding_number;                           // have a valid down intersect
-        }
-      }
-    }
-  }
-  return winding_number != 0;
+  return batch_intersect::winding_number(point, ring) != 0;
 }
 
 class nested_polygon_type_fp {
@@ -148,17 +136,25 @@ class Neighbors {
     bool operator!=(const iterator& other) const;
     bool operator==(const iterator& other) const;
     const point_type_fp& operator*() const;
+    // Start is 0, goal is 1 and the vertices follow.
+    size_t index() const { return point_index; }
    private:
     const Neighbors* neighbors;
     size_t point_index;
   };
 
+  // visibility is the row of the visibility graph for current or
+  // nullptr if there isn't one.
   Neighbors(const point_type_fp& start, const point_type_fp& goal,
             const point_type_fp& current,
             const coordinate_type_fp& max_path_length,
             const std::vector<point_type_fp>& vertices,
-            const PathFindingSurface* pfs);
-  inline bool is_neighbor(const point_type_fp p) const;
+            std::atomic<uint8_t>* visibility,
+            const PathFindingSurface* pfs,
+            boost::optional<size_t>& tries);
+  // Start is 0, goal is 1 and the vertices follow.
+  const point_type_fp& point(size_t point_index) const;
+  inline bool is_neighbor(size_t point_index) const;
   iterator begin() const;
   iterator end() const;
   const point_type_fp& start;
@@ -168,7 +164,9 @@ class Neighbors {
  private:
   const coordinate_type_fp max_path_length_squared;
   const std::vector<point_type_fp>& vertices;
+  std::atomic<uint8_t>* const visibility;
   const PathFindingSurface* pfs;
+  boost::optional<size_t>& tries;
 };
 
 class PathFindingSurface {
@@ -176,16 +174,20 @@ class PathFindingSurface {
   // Create a surface for doing path finding.  It can be used multiple times.  The
   // surface available for paths is within the keep_in and also outside the
   // keep_out.  If those are missing, they are ignored.  The tolerance should be a
-  // small epsilon value.
+  // small epsilon value.  All the const methods may be called from
+  // multiple threads at the same time.
   PathFindingSurface(const boost::optional<multi_polygon_type_fp>& keep_in,
                      const multi_polygon_type_fp& keep_out,
                      const coordinate_type_fp tolerance);
   const boost::optional<SearchKey>& in_surface(point_type_fp p) const;
-  void decrement_tries() const;
+  // Throws GiveUp if there are no tries remaining.  No value means
+  // unlimited tries.
+  static void decrement_tries(boost::optional<size_t>& tries);
   Neighbors neighbors(const point_type_fp& start, const point_type_fp& goal,
                       const coordinate_type_fp& max_path_length,
                       SearchKey search_key,
-                      const point_type_fp& current) const;
+                      const point_type_fp& current,
+                      boost::optional<size_t>& tries) const;
   // Find a path from start to goal in the available surface, limited
   // in operations.
   boost::optional<linestring_type_fp> find_path(
@@ -206,10 +208,17 @@ class PathFindingSurface {
   friend class Neighbors;
   bool in_surface(
       const point_type_fp& a, const point_type_fp& b) const;
+  // The same as in_surface but without the memo.
+  bool segment_in_surface(
+      const point_type_fp& a, const point_type_fp& b) const;
+  // The row of the visibility graph for the vertex at p, or nullptr
+  // if p isn't a vertex or the graph has reached its size limit.
+  std::atomic<uint8_t>* visibility_row(SearchKey search_key, const point_type_fp& p) const;
   boost::optional<linestring_type_fp> find_path(
       const point_type_fp& start, const point_type_fp& goal,
       const coordinate_type_fp& max_path_length,
-      SearchKey search_key) const;
+      SearchKey search_key,
+      boost::optional<size_t>& tries) const;
 
   // Each shape corresponses to an element in all_vertices and they
   // are in the same order.  The boolean indicates if this is the
@@ -223,15 +232,39 @@ class PathFindingSurface {
   std::vector<std::vector<std::vector<point_type_fp>>> all_vertices;
   mutable std::unordered_map<std::pair<point_type_fp, point_type_fp>, bool> edge_in_surface_memo;
   // RingIndices can be very large and slow to hash so we'll store
-  // them here and elsewhere just store the index into this list.
-  mutable std::vector<RingIndices> ring_indices_cache;
+  // them here and elsewhere just store the index into this list.  A
+  // deque so that references to the entries stay valid as it grows
+  // and can be used without the lock.
+  mutable std::deque<RingIndices> ring_indices_cache;
   mutable std::unordered_map<RingIndices, size_t,
                              std::hash<RingIndices>,
                              std::equal_to<RingIndices>> ring_indices_lookup;
   mutable std::unordered_map<point_type_fp, boost::optional<SearchKey>> point_in_surface_memo;
   segment_tree::SegmentTree tree;
   mutable std::unordered_map<SearchKey, std::vector<point_type_fp>> vertices_memo;
-  mutable boost::optional<size_t> tries; // This is not great to be mutable.
+  // Which of the vertices of a search key can be connected with a
+  // straight line in the surface.  A row is made for a vertex when a
+  // search first visits it and then has an entry for each vertex: 0
+  // if not yet known, 1 if the line is in the surface and 2 if not.
+  // The entries are filled in as the searches look at them so they
+  // don't have to go through edge_in_surface_memo.
+  struct VisibilityGraph {
+    // The first index of each vertex, and for each index the first
+    // index with the same vertex.  These don't change once made.
+    std::unordered_map<point_type_fp, size_t> vertex_index;
+    std::vector<size_t> first_index;
+    std::vector<std::unique_ptr<std::atomic<uint8_t>[]>> rows;
+  };
+  // The graph for the search key, which has the search_vertices.
+  // Must be called with the memo_mutex held.
+  VisibilityGraph& visibility_graph(SearchKey search_key,
+                                    const std::vector<point_type_fp>& search_vertices) const;
+  mutable std::unordered_map<SearchKey, VisibilityGraph> visibility_memo;
+  // The total size of all the rows, which is limited.
+  mutable size_t visibility_size = 0;
+  // Guards all the mutable memos above.  It's a pointer so that the
+  // surface remains movable.
+  std::unique_ptr<std::mutex> memo_mutex;
 };
 
 struct GiveUp {};
@@ -565,4 +565,27 @@ BOOST_AUTO_TEST_CASE(u_shape_keep_out) {
   BOOST_CHECK_EQUAL(ret, boost::make_optional(expected));
 }
 
+// Searches that reuse the visibility found by earlier searches give
+// the same paths as searches on a new surface.
+BOOST_AUTO_TEST_CASE(reuse_visibility) {
+  multi_polygon_type_fp almost_doughnut{
+    {{{0,0}, {0,100}, {49,100}, {49,80},
+      {30,70}, {20,20}, {80,20}, {80,80},
+      {51,80}, {51,100}, {100,100},
+      {100,0}, {0,0}}}};
+  const vector<pair<point_type_fp, point_type_fp>> searches{
+    {{10,10}, {90,90}}, {{90,90}, {10,10}}, {{50,90}, {10,50}},
+    {{10,90}, {90,10}}, {{50,10}, {50,90}}, {{90,50}, {40,95}}};
+  auto surface = PathFindingSurface(almost_doughnut, multi_polygon_type_fp(), 3);
+  for (const auto& max_length : {infinity, 100.0}) {
+    for (const auto& search : searches) {
+      auto new_surface = PathFindingSurface(almost_doughnut, multi_polygon_type_fp(), 3);
+      BOOST_CHECK_EQUAL(surface.find_path(search.first, search.second, max_length, boost::none),
+                        new_surface.find_path(search.first, search.second, max_length, boost::none));
+      BOOST_CHECK_EQUAL(surface.find_path(search.first, search.second, max_length, size_t(50)),
+                        new_surface.find_path(search.first, search.second, max_length, size_t(50)));
+    }
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,142 @@
+#!/usr/bin/python3
+
+"""Check pcb2gcode for performance regressions.
+
+Runs every test case of integration_tests.py a few times and records
+the median wall time and peak memory of each.  With --update, the
+results are saved as the baseline.  Otherwise they are compared to the
+baseline and the run fails if any case got slower or bigger than the
+threshold allows.  Baselines are only meaningful on the machine that
+made them.
+
+Only the standard library is needed.
+"""
+
+from __future__ import print_function
+import argparse
+import json
+import os
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+from integration_test_cases import TEST_CASES
+
+def run_once(pcb2gcode, test_case):
+  """Run one test case and return (exit code, wall time, peak rss in bytes)."""
+  output_path = tempfile.mkdtemp()
+  try:
+    cmd = [pcb2gcode]
+    if not any("output-dir" in x for x in test_case.args):
+      cmd += ["--output-dir", output_path]
+    cmd += test_case.args
+    with open(os.devnull, "w") as devnull:
+      start = time.time()
+      proc = subprocess.Popen(cmd, cwd=test_case.input_path, stdout=devnull, stderr=devnull)
+      _, status, usage = os.wait4(proc.pid, 0)
+      wall_time = time.time() - start
+  finally:
+    shutil.rmtree(output_path)
+  exit_code = os.WEXITSTATUS(status) if os.WIFEXITED(status) else -1
+  # ru_maxrss is in kilobytes on Linux.
+  return exit_code, wall_time, usage.ru_maxrss * 1024
+
+def median(values):
+  values = sorted(values)
+  middle = len(values) // 2
+  if len(values) % 2:
+    return values[middle]
+  return (values[middle - 1] + values[middle]) / 2.0
+
+def measure(pcb2gcode, test_case, runs):
+  """Returns the median wall time and peak rss of the test case."""
+  wall_times = []
+  peak_rsses = []
+  for _ in range(runs):
+    exit_code, wall_time, peak_rss = run_once(pcb2gcode, test_case)
+    if exit_code != test_case.exit_code:
+      raise RuntimeError("%s exited with %d instead of %d" %
+                         (test_case.name, exit_code, test_case.exit_code))
+    wall_times.append(wall_time)
+    peak_rsses.append(peak_rss)
+  return {"wall_time": median(wall_times), "peak_rss": median(peak_rsses)}
+
+def regressions(name, result, baseline, args):
+  """Returns a list of descriptions of how result is worse than baseline."""
+  problems = []
+  allowed_time = baseline["wall_time"] * (1 + args.threshold) + args.time_slack
+  if result["wall_time"] > allowed_time:
+    problems.append("%s: wall time %.3fs is more than %.3fs (baseline %.3fs)" %
+                    (name, result["wall_time"], allowed_time, baseline["wall_time"]))
+  allowed_rss = baseline["peak_rss"] * (1 + args.memory_threshold)
+  if result["peak_rss"] > allowed_rss:
+    problems.append("%s: peak memory %.1fMB is more than %.1fMB (baseline %.1fMB)" %
+                    (name, result["peak_rss"] / 1048576.0, allowed_rss / 1048576.0,
+                     baseline["peak_rss"] / 1048576.0))
+  return problems
+
+def main():
+  parser = argparse.ArgumentParser(description=__doc__,
+                                   formatter_class=argparse.RawDescriptionHelpFormatter)
+  parser.add_argument('--baseline', default='perf_baseline.json',
+                      help='file of baseline results')
+  parser.add_argument('--update', action='store_true', default=False,
+                      help='save the results as the new baseline instead of comparing')
+  parser.add_argument('--runs', type=int, default=3,
+                      help='number of runs of each test case, the median is used')
+  parser.add_argument('--threshold', type=float, default=0.2,
+                      help='fraction of wall time increase that is allowed')
+  parser.add_argument('--time-slack', type=float, default=0.05,
+                      help='seconds of wall time increase that are always allowed, for short cases')
+  parser.add_argument('--memory-threshold', type=float, default=0.2,
+                      help='fraction of peak memory increase that is allowed')
+  parser.add_argument('--tests', type=str, default="",
+                      help='regex of tests to run')
+  parser.add_argument('--pcb2gcode', default=os.path.join(os.getcwd(), "pcb2gcode"),
+                      help='path to the pcb2gcode binary')
+  args = parser.parse_args()
+  pcb2gcode = os.path.abspath(args.pcb2gcode)
+  test_cases = [t for t in TEST_CASES if re.search(args.tests, t.name)]
+
+  baseline = {}
+  if os.path.exists(args.baseline):
+    with open(args.baseline) as f:
+      baseline = json.load(f)
+  elif not args.update:
+    print("No baseline in %s, run with --update to make one." % args.baseline)
+    return 1
+
+  results = {}
+  problems = []
+  for test_case in test_cases:
+    result = measure(pcb2gcode, test_case, args.runs)
+    results[test_case.name] = result
+    status = ""
+    if not args.update:
+      if test_case.name not in baseline:
+        status = "  (not in baseline)"
+      else:
+        new_problems = regressions(test_case.name, result, baseline[test_case.name], args)
+        problems += new_problems
+        status = "  REGRESSED" if new_problems else ""
+    print("%-50s %8.3fs %8.1fMB%s" %
+          (test_case.name, result["wall_time"], result["peak_rss"] / 1048576.0, status))
+    sys.stdout.flush()
+
+  if args.update:
+    # Keep the baselines of tests that weren't run this time.
+    baseline.update(results)
+    with open(args.baseline, "w") as f:
+      json.dump(baseline, f, indent=2, sort_keys=True)
+    print("Saved %d results to %s." % (len(results), args.baseline))
+    return 0
+  if problems:
+    print("\n***\nPerformance regressions:\n" + "\n".join(problems) + "\n***")
+    return 1
+  return 0
+
+if __name__ == '__main__':
+  sys.exit(main())
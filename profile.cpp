@@ -0,0 +1,191 @@
+#include "profile.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <sstream>
+
+#include <boost/system/api_config.hpp>  // for BOOST_POSIX_API or BOOST_WINDOWS_API
+
+#ifdef BOOST_POSIX_API
+#include <sys/resource.h>
+#include <time.h>
+#endif
+
+namespace profile {
+
+using std::string;
+using std::vector;
+
+namespace {
+
+std::atomic<bool> is_enabled(false);
+std::mutex stages_mutex;
+// By name, with the index into the order of first use.
+std::map<string, size_t> stage_indices;
+vector<Stage> all_stages;
+
+double wall_now() {
+  return std::chrono::duration<double>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// CPU time of the calling thread so that stages running at the same
+// time on other threads aren't counted.
+double cpu_now() {
+#if defined(BOOST_POSIX_API) && defined(CLOCK_THREAD_CPUTIME_ID)
+  struct timespec ts;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+  }
+#endif
+  return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+}
+
+// Must be called with stages_mutex held.
+Stage& get_stage(const char* name) {
+  auto inserted = stage_indices.emplace(name, all_stages.size());
+  if (inserted.second) {
+    all_stages.emplace_back();
+    all_stages.back().name = name;
+  }
+  return all_stages[inserted.first->second];
+}
+
+string json_string(const string& s) {
+  string result = "\"";
+  for (char c : s) {
+    if (c == '"' || c == '\\') {
+      result += '\\';
+    }
+    result += c;
+  }
+  return result + "\"";
+}
+
+} // namespace
+
+void enable(bool enabled) {
+  is_enabled = enabled;
+}
+
+bool enabled() {
+  return is_enabled;
+}
+
+void reset() {
+  std::lock_guard<std::mutex> lock(stages_mutex);
+  stage_indices.clear();
+  all_stages.clear();
+}
+
+Timer::Timer(const char* stage) :
+    stage(stage),
+    active(enabled()),
+    wall_start(active ? wall_now() : 0),
+    cpu_start(active ? cpu_now() : 0) {}
+
+Timer::~Timer() {
+  if (!active) {
+    return;
+  }
+  const double wall_time = wall_now() - wall_start;
+  const double cpu_time = cpu_now() - cpu_start;
+  const size_t rss = peak_rss();
+  std::lock_guard<std::mutex> lock(stages_mutex);
+  Stage& s = get_stage(stage);
+  s.calls++;
+  s.wall_time += wall_time;
+  s.cpu_time += cpu_time;
+  s.peak_rss = std::max(s.peak_rss, rss);
+}
+
+void count(const char* stage, const char* counter, size_t amount) {
+  if (!enabled()) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(stages_mutex);
+  auto& counters = get_stage(stage).counters;
+  auto it = std::find_if(counters.begin(), counters.end(),
+                         [&](const std::pair<string, size_t>& c) { return c.first == counter; });
+  if (it == counters.end()) {
+    counters.emplace_back(counter, amount);
+  } else {
+    it->second += amount;
+  }
+}
+
+vector<Stage> stages() {
+  std::lock_guard<std::mutex> lock(stages_mutex);
+  return all_stages;
+}
+
+size_t peak_rss() {
+#ifdef BOOST_POSIX_API
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+    return usage.ru_maxrss; // Already in bytes.
+#else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+  }
+#endif
+  return 0;
+}
+
+void report_table(std::ostream& out) {
+  const auto all = stages();
+  size_t name_width = 5;
+  for (const auto& s : all) {
+    name_width = std::max(name_width, s.name.size());
+  }
+  std::ostringstream table;
+  table << std::left << std::setw(name_width) << "stage" << std::right
+        << std::setw(10) << "calls"
+        << std::setw(12) << "wall (s)"
+        << std::setw(12) << "cpu (s)"
+        << std::setw(14) << "peak rss (MB)" << "\n";
+  table << std::fixed;
+  for (const auto& s : all) {
+    table << std::left << std::setw(name_width) << s.name << std::right
+          << std::setw(10) << s.calls
+          << std::setw(12) << std::setprecision(3) << s.wall_time
+          << std::setw(12) << std::setprecision(3) << s.cpu_time
+          << std::setw(14) << std::setprecision(1) << s.peak_rss / (1024.0 * 1024.0) << "\n";
+    for (const auto& c : s.counters) {
+      table << "  " << c.first << ": " << c.second << "\n";
+    }
+  }
+  table << "peak rss: " << std::setprecision(1) << peak_rss() / (1024.0 * 1024.0) << " MB\n";
+  out << table.str();
+}
+
+void report_json(std::ostream& out) {
+  const auto all = stages();
+  std::ostringstream json;
+  json << std::setprecision(6);
+  json << "{\n  \"peak_rss\": " << peak_rss() << ",\n  \"stages\": [";
+  for (size_t i = 0; i < all.size(); i++) {
+    const auto& s = all[i];
+    json << (i == 0 ? "\n" : ",\n")
+         << "    {\"name\": " << json_string(s.name)
+         << ", \"calls\": " << s.calls
+         << ", \"wall_time\": " << s.wall_time
+         << ", \"cpu_time\": " << s.cpu_time
+         << ", \"peak_rss\": " << s.peak_rss
+         << ", \"counters\": {";
+    for (size_t j = 0; j < s.counters.size(); j++) {
+      json << (j == 0 ? "" : ", ") << json_string(s.counters[j].first) << ": " << s.counters[j].second;
+    }
+    json << "}}";
+  }
+  json << (all.empty() ? "]\n}\n" : "\n  ]\n}\n");
+  out << json.str();
+}
+
+} // namespace profile
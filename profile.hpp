@@ -0,0 +1,66 @@
+#ifndef PROFILE_HPP
+#define PROFILE_HPP
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Timers and counters for each stage of the pipeline, for seeing where
+// the time goes.  Nothing is recorded unless profiling is enabled so
+// the timers can stay in the code at little cost.  Stages may run on
+// many threads at once.
+namespace profile {
+
+struct Stage {
+  std::string name;
+  size_t calls = 0;
+  // Total over all calls and all threads, in seconds.
+  double wall_time = 0;
+  double cpu_time = 0;
+  // The largest peak resident set size of the process seen at the end
+  // of a call, in bytes, or 0 if it's unknown.
+  size_t peak_rss = 0;
+  // Counters added with count().
+  std::vector<std::pair<std::string, size_t>> counters;
+};
+
+void enable(bool enabled);
+bool enabled();
+// Forget everything that has been recorded.
+void reset();
+
+// Records one call to the stage from construction to destruction.
+// Nested timers are each recorded so a stage's time includes the
+// stages within it.  stage must outlive the program, so use a string
+// literal.
+class Timer {
+ public:
+  explicit Timer(const char* stage);
+  Timer(const Timer&) = delete;
+  Timer& operator=(const Timer&) = delete;
+  ~Timer();
+
+ private:
+  const char* const stage;
+  const bool active;
+  double wall_start;
+  double cpu_start;
+};
+
+// Add to a named counter of the stage, like the number of points
+// processed.
+void count(const char* stage, const char* counter, size_t amount = 1);
+
+// Stages in the order that they were first recorded.
+std::vector<Stage> stages();
+// The peak resident set size of the process so far, in bytes, or 0
+// if it's unknown.
+size_t peak_rss();
+
+// Write a table or JSON of all stages.
+void report_table(std::ostream& out);
+void report_json(std::ostream& out);
+
+} // namespace profile
+
+#endif // PROFILE_HPP
@@ -0,0 +1,90 @@
+#define BOOST_TEST_MODULE profile tests
+#include <boost/test/unit_test.hpp>
+
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "profile.hpp"
+
+using std::string;
+using std::vector;
+
+BOOST_AUTO_TEST_SUITE(profile_tests)
+
+BOOST_AUTO_TEST_CASE(disabled) {
+  profile::reset();
+  profile::enable(false);
+  {
+    profile::Timer timer("a");
+    profile::count("a", "things");
+  }
+  BOOST_CHECK(profile::stages().empty());
+}
+
+BOOST_AUTO_TEST_CASE(calls_and_counters) {
+  profile::reset();
+  profile::enable(true);
+  for (int i = 0; i < 3; i++) {
+    profile::Timer outer("outer");
+    profile::Timer inner("inner");
+    profile::count("inner", "things", 2);
+  }
+  profile::count("inner", "other");
+  profile::enable(false);
+  const auto stages = profile::stages();
+  BOOST_REQUIRE_EQUAL(stages.size(), 2);
+  BOOST_CHECK_EQUAL(stages[0].name, "inner");
+  BOOST_CHECK_EQUAL(stages[0].calls, 3);
+  BOOST_CHECK((stages[0].counters == vector<std::pair<string, size_t>>{{"things", 6}, {"other", 1}}));
+  BOOST_CHECK_EQUAL(stages[1].name, "outer");
+  BOOST_CHECK_EQUAL(stages[1].calls, 3);
+  BOOST_CHECK_GE(stages[1].wall_time, stages[0].wall_time);
+  BOOST_CHECK_GE(stages[0].cpu_time, 0);
+}
+
+BOOST_AUTO_TEST_CASE(threads) {
+  profile::reset();
+  profile::enable(true);
+  vector<std::thread> workers;
+  for (int i = 0; i < 4; i++) {
+    workers.emplace_back([]() {
+      for (int j = 0; j < 100; j++) {
+        profile::Timer timer("work");
+      }
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  profile::enable(false);
+  const auto stages = profile::stages();
+  BOOST_REQUIRE_EQUAL(stages.size(), 1);
+  BOOST_CHECK_EQUAL(stages[0].calls, 400);
+}
+
+BOOST_AUTO_TEST_CASE(reports) {
+  profile::reset();
+  profile::enable(true);
+  {
+    profile::Timer timer("stage \"quoted\"");
+    profile::count("stage \"quoted\"", "things", 5);
+  }
+  profile::enable(false);
+  std::ostringstream json;
+  profile::report_json(json);
+  BOOST_CHECK_NE(json.str().find("\"name\": \"stage \\\"quoted\\\"\", \"calls\": 1,"), string::npos);
+  BOOST_CHECK_NE(json.str().find("\"counters\": {\"things\": 5}}"), string::npos);
+  std::ostringstream table;
+  profile::report_table(table);
+  BOOST_CHECK_EQUAL(table.str().find("stage"), 0);
+  BOOST_CHECK_NE(table.str().find("  things: 5\n"), string::npos);
+
+  profile::reset();
+  std::ostringstream empty;
+  profile::report_json(empty);
+  BOOST_CHECK_NE(empty.str().find("\"stages\": []"), string::npos);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
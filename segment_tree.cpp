@@ -4,23 +4,33 @@ using std::vector;
 #include <utility>
 using std::pair;
 
-#include <boost/optional.hpp>
+#include <algorithm>
+#include <limits>
 
 #include "bg_operators.hpp"
 
 #include "segment_tree.hpp"
-#include "value_ptr.hpp"
-using smart_ptr::value_ptr;
-using smart_ptr::make_value;
 
 namespace segment_tree {
 
+BucketEntry::BucketEntry(segment_t segment) :
+    segment(segment),
+    min_x_bound(std::numeric_limits<coordinate_type_fp>::infinity()),
+    min_y_bound(std::numeric_limits<coordinate_type_fp>::infinity()),
+    max_x_bound(-std::numeric_limits<coordinate_type_fp>::infinity()),
+    max_y_bound(-std::numeric_limits<coordinate_type_fp>::infinity()) {}
+
 template <bool on_x, bool less_than>
-value_ptr<Node> make_node(vector<segment_t>::iterator segments_begin,
-                          vector<segment_t>::iterator segments_end) {
+void SegmentTree::make_node(vector<BucketEntry>& entries,
+                            size_t segments_begin, size_t segments_end,
+                            size_t node, size_t level) {
+  if (level == levels) {
+    // This is the start of a bucket.
+    bucket_begin[node - intercepts.size()] = segments_begin;
+  }
   if (segments_end - segments_begin == 1) {
     // We're done.
-    return make_value<Node>(*segments_begin);
+    return;
   }
   // Sort the segments as specified by on_x and less_than.
   coordinate_type_fp (segment_t::*corner_axis_selector)() const;
@@ -38,22 +48,37 @@ value_ptr<Node> make_node(vector<segment_t>::iterator segments_begin,
     corner_axis_selector = &segment_t::min_y;
     factor = -1;
   }
-  std::sort(segments_begin, segments_end,
-            [&](const segment_t& s0,
-                const segment_t& s1) {
-              return factor * (s0.*corner_axis_selector)() < factor * (s1.*corner_axis_selector)();
+  std::sort(entries.begin() + segments_begin, entries.begin() + segments_end,
+            [&](const BucketEntry& s0,
+                const BucketEntry& s1) {
+              return factor * (s0.segment.*corner_axis_selector)() < factor * (s1.segment.*corner_axis_selector)();
             });
   // Find the middle.  It will round down.  You can't add begin and
   // end, it might overflow.  Behavior is undefined.
   auto mid = segments_begin + (segments_end - segments_begin)/2;
 
-  const auto new_intercept = ((*mid).*corner_axis_selector)();
+  const auto new_intercept = (entries[mid].segment.*corner_axis_selector)();
+  if (level < levels) {
+    intercepts[node] = new_intercept;
+  } else {
+    // Inside a bucket, the segments before mid are only tested if the
+    // query would have reached them in intersects().
+    for (auto entry = entries.begin() + segments_begin; entry != entries.begin() + mid; entry++) {
+      if (less_than && on_x) {
+        entry->min_x_bound = std::min(entry->min_x_bound, new_intercept);
+      } else if (less_than && !on_x) {
+        entry->min_y_bound = std::min(entry->min_y_bound, new_intercept);
+      } else if (!less_than && on_x) {
+        entry->max_x_bound = std::max(entry->max_x_bound, new_intercept);
+      } else if (!less_than && !on_x) {
+        entry->max_y_bound = std::max(entry->max_y_bound, new_intercept);
+      }
+    }
+  }
   constexpr auto new_on_x = less_than ^ on_x;
   constexpr auto new_less_than = !less_than;
-  // mid will get changed below so we neeed to store the intercept.
-  return make_value<Node>(new_intercept,
-                          make_node<new_on_x, new_less_than>(segments_begin, mid),
-                          make_node<new_on_x, new_less_than>(mid, segments_end));
+  make_node<new_on_x, new_less_than>(entries, segments_begin, mid, 2*node + 1, level + 1);
+  make_node<new_on_x, new_less_than>(entries, mid, segments_end, 2*node + 2, level + 1);
 }
 
 constexpr bool START_ON_X = true;
@@ -61,93 +86,41 @@ constexpr bool START_LESS_THAN = true;
 
 SegmentTree::SegmentTree(const vector<std::pair<point_type_fp, point_type_fp>>& segments_in) {
   // For each segment, find the bounding box.
-  vector<segment_t> segments;
-  segments.reserve(segments_in.size());
+  vector<BucketEntry> entries;
+  entries.reserve(segments_in.size());
   for (const auto& segment : segments_in) {
-    segments.emplace_back(segment.first, segment.second);
-  }
-  if (segments.size() > 0) {
-    root = make_node<START_ON_X, START_LESS_THAN>(segments.begin(), segments.end());
+    entries.emplace_back(segment_t(segment.first, segment.second));
   }
-}
-
-// is_left(): tests if a point is Left|On|Right of an infinite line.
-//    Input:  three points p0, p1, and p2
-//    Return: >0 for p2 left of the line through p0 and p1
-//            =0 for p2 on the line
-//            <0 for p2 right of the line
-//    See: Algorithm 1 "Area of Triangles and Polygons"
-//    This is p0p1 cross p0p2.
-static inline coordinate_type_fp is_left(point_type_fp p0, point_type_fp p1, point_type_fp p2) {
-  return ((p1.x() - p0.x()) * (p2.y() - p0.y()) -
-          (p2.x() - p0.x()) * (p1.y() - p0.y()));
-}
-
-// Is x between a and b, where a can be lesser or greater than b.  If
-// x == a or x == b, also returns true. */
-extern inline coordinate_type_fp is_between(coordinate_type_fp a,
-                                            coordinate_type_fp x,
-                                            coordinate_type_fp b) {
-  return x == a || x == b || (a-x>0) == (x-b>0);
-}
-
-
-// https://stackoverflow.com/questions/563198/how-do-you-detect-where-two-line-segments-intersect
-static inline bool is_intersecting(const point_type_fp& p0, const point_type_fp& p1,
-                                   const point_type_fp& p2, const point_type_fp& p3) {
-  const coordinate_type_fp left012 = is_left(p0, p1, p2);
-  const coordinate_type_fp left013 = is_left(p0, p1, p3);
-  const coordinate_type_fp left230 = is_left(p2, p3, p0);
-  const coordinate_type_fp left231 = is_left(p2, p3, p1);
-
-  if (p0 != p1) {
-    if (left012 == 0) {
-      if (is_between(p0.x(), p2.x(), p1.x()) &&
-          is_between(p0.y(), p2.y(), p1.y())) {
-        return true; // p2 is on the line p0 to p1
-      }
-    }
-    if (left013 == 0) {
-      if (is_between(p0.x(), p3.x(), p1.x()) &&
-          is_between(p0.y(), p3.y(), p1.y())) {
-        return true; // p3 is on the line p0 to p1
-      }
-    }
+  if (entries.size() == 0) {
+    return;
   }
-  if (p2 != p3) {
-    if (left230 == 0) {
-      if (is_between(p2.x(), p0.x(), p3.x()) &&
-          is_between(p2.y(), p0.y(), p3.y())) {
-        return true; // p0 is on the line p2 to p3
-      }
-    }
-    if (left231 == 0) {
-      if (is_between(p2.x(), p1.x(), p3.x()) &&
-          is_between(p2.y(), p1.y(), p3.y())) {
-        return true; // p1 is on the line p2 to p3
-      }
-    }
+  // The halves differ in size by at most one so every bucket is at
+  // the same level and none is bigger than the biggest one.
+  while (((entries.size() - 1) >> levels) + 1 > bucket_size) {
+    levels++;
   }
-  if ((left012 > 0) == (left013 > 0) ||
-      (left230 > 0) == (left231 > 0)) {
-    if (p1 == p2) {
-      return true;
-    }
-    return false;
-  } else {
-    return true;
+  intercepts.resize((size_t(1) << levels) - 1);
+  bucket_begin.resize((size_t(1) << levels) + 1);
+  bucket_begin.back() = entries.size();
+  make_node<START_ON_X, START_LESS_THAN>(entries, 0, entries.size(), 0, 0);
+  segments.reserve(entries.size());
+  for (const auto& entry : entries) {
+    segments.push_back(entry.segment.first(), entry.segment.second(),
+                       entry.min_x_bound, entry.min_y_bound,
+                       entry.max_x_bound, entry.max_y_bound);
   }
 }
 
 template <bool on_x, bool less_than>
-bool intersects(const segment_t& segment, const value_ptr<Node>& node) {
-  if (node->segment) {
-    return is_intersecting(segment.first(), segment.second(),
-                           node->segment->first(), node->segment->second());
+bool SegmentTree::intersects(const segment_t& segment, size_t node, size_t level) const {
+  if (level == levels) {
+    const size_t bucket = node - intercepts.size();
+    return batch_intersect::any_intersecting(segment.first(), segment.second(), segments,
+                                             bucket_begin[bucket], bucket_begin[bucket + 1]);
   }
   constexpr auto new_on_x = less_than ^ on_x;
   constexpr auto new_less_than = !less_than;
-  if (intersects<new_on_x, new_less_than>(segment, node->out)) {
+  if (intersects<new_on_x, new_less_than>(segment, 2*node + 2, level + 1)) {
     return true;
   }
   coordinate_type_fp (segment_t::*corner_axis_selector)() const;
@@ -165,38 +138,43 @@ bool intersects(const segment_t& segment, const value_ptr<Node>& node) {
     corner_axis_selector = &segment_t::max_y;
     factor = 1;
   }
-  if (!(factor * (segment.*corner_axis_selector)() < factor * node->intercept)) {
-    return intersects<new_on_x, new_less_than>(segment, node->in);
+  if (!(factor * (segment.*corner_axis_selector)() < factor * intercepts[node])) {
+    return intersects<new_on_x, new_less_than>(segment, 2*node + 1, level + 1);
   }
   return false;
 }
 
 bool SegmentTree::intersects(const point_type_fp& p0, const point_type_fp& p1) const {
-  if (root == nullptr) {
+  if (segments.size() == 0) {
     return false;
   }
-  return segment_tree::intersects<START_ON_X, START_LESS_THAN>(segment_t(p0, p1), root);
+  return intersects<START_ON_X, START_LESS_THAN>(segment_t(p0, p1), 0, 0);
 }
 
 template <bool on_x, bool less_than>
-void print_node(const value_ptr<Node>& node, std::string indent = "") {
-  if (node->segment) {
-    std::cout << indent << bg::wkt(node->segment->first()) << " "
-              << bg::wkt(node->segment->second()) << std::endl;
+void SegmentTree::print_node(size_t node, size_t level, std::string indent) const {
+  if (level == levels) {
+    const size_t bucket = node - intercepts.size();
+    for (size_t i = bucket_begin[bucket]; i < bucket_begin[bucket + 1]; i++) {
+      std::cout << indent << bg::wkt(segments.first(i)) << " "
+                << bg::wkt(segments.second(i)) << std::endl;
+    }
     return;
   }
   std::cout << indent << "if all "
             << (on_x ? "x" : "y") << " is " << (!less_than ? "less than" : "greater than")
-            << " " << node->intercept << " then:" << std::endl;
+            << " " << intercepts[node] << " then:" << std::endl;
   constexpr auto new_on_x = less_than ^ on_x;
   constexpr auto new_less_than = !less_than;
-  print_node<new_on_x, new_less_than>(node->out, indent + "  ");
+  print_node<new_on_x, new_less_than>(2*node + 2, level + 1, indent + "  ");
   std::cout << indent << "else the above and:" << std::endl;
-  print_node<new_on_x, new_less_than>(node->in, indent + "  ");
+  print_node<new_on_x, new_less_than>(2*node + 1, level + 1, indent + "  ");
 }
 
 void SegmentTree::print() {
-  print_node<START_ON_X, START_LESS_THAN>(root);
+  if (segments.size() > 0) {
+    print_node<START_ON_X, START_LESS_THAN>(0, 0, "");
+  }
 }
 
 } //namespace path_finding
@@ -2,10 +2,10 @@
 #define SEGMENT_TREE_HPP
 
 #include "geometry.hpp"
-#include "value_ptr.hpp"
+#include "batch_intersect.hpp"
+#include <string>
 #include <vector>
 #include <utility>
-#include <boost/optional.hpp>
 
 // A segment tree is initialized with a list of segments.  The
 // segments can have any orientation and may have duplicates.  It can
@@ -42,21 +42,25 @@ class segment_t {
   bool positive_slope_;
 };
 
-struct Node {
-  Node(coordinate_type_fp intercept,
-       smart_ptr::value_ptr<Node> in,
-       smart_ptr::value_ptr<Node> out) :
-    intercept(intercept),
-    in(std::move(in)),
-    out(std::move(out)) {}
-  Node(segment_t segment) :
-    segment(segment) {}
-  const coordinate_type_fp intercept = 0; // Where it crosses the axis.
-  const smart_ptr::value_ptr<Node> in; // Edges that match the criteria above.
-  const smart_ptr::value_ptr<Node> out; // Edges that don't match the criteria above.
-  const boost::optional<segment_t> segment; // The segment at this node (leaves only).
+// A segment in a leaf bucket.  The bucket would have been split
+// further in a tree with one segment per leaf.  Instead, each segment
+// remembers the intercepts of the splits that it would have been
+// behind and the query segment must reach them all for the segment to
+// be tested.
+struct BucketEntry {
+  BucketEntry(segment_t segment);
+  segment_t segment;
+  coordinate_type_fp min_x_bound; // Tested if the query min_x is at most this.
+  coordinate_type_fp min_y_bound; // Tested if the query min_y is at most this.
+  coordinate_type_fp max_x_bound; // Tested if the query max_x is at least this.
+  coordinate_type_fp max_y_bound; // Tested if the query max_y is at least this.
 };
 
+// The tree is complete so it is stored in arrays instead of nodes.
+// The intercepts are in breadth first order: The children of node i
+// are at 2i+1 (the edges that match the criteria) and 2i+2 (the rest).
+// The levels below the last level of intercepts are in buckets of at
+// most bucket_size segments which are tested together.
 class SegmentTree {
  public:
   SegmentTree(const SegmentTree&) = delete;
@@ -67,8 +71,23 @@ class SegmentTree {
   SegmentTree(const std::vector<std::pair<point_type_fp, point_type_fp>>& segments = {});
   void print();
   bool intersects(const point_type_fp& p0, const point_type_fp& p1) const;
+
+  static constexpr size_t bucket_size = 8;
  private:
-  smart_ptr::value_ptr<Node> root;
+  template <bool on_x, bool less_than>
+  void make_node(std::vector<BucketEntry>& entries,
+                 size_t segments_begin, size_t segments_end,
+                 size_t node, size_t level);
+  template <bool on_x, bool less_than>
+  bool intersects(const segment_t& segment, size_t node, size_t level) const;
+  template <bool on_x, bool less_than>
+  void print_node(size_t node, size_t level, std::string indent) const;
+
+  size_t levels = 0; // The number of levels of intercepts.
+  std::vector<coordinate_type_fp> intercepts;
+  // Bucket b is from bucket_begin[b] to bucket_begin[b+1] in segments.
+  std::vector<size_t> bucket_begin;
+  batch_intersect::SegmentBlock segments;
 };
 
 } //namespace segment_tree
@@ -18,4 +18,26 @@ BOOST_AUTO_TEST_CASE(make_node) {
   auto tree = SegmentTree(segments);
   tree.print();
 }
+
+// Enough segments for many buckets.  The coordinates are small
+// integers so that there are many touching and collinear segments.
+BOOST_AUTO_TEST_CASE(buckets) {
+  vector<std::pair<point_type_fp, point_type_fp>> segments;
+  for (int i = 0; i < 200; i++) {
+    segments.push_back({{double(i * 7 % 23), double(i * 11 % 19)},
+                        {double(i * 5 % 17), double(i * 3 % 29)}});
+  }
+  auto tree = SegmentTree(segments);
+  for (int i = 0; i < 500; i++) {
+    const point_type_fp p0(i * 13 % 31 - 2, i * 17 % 37 - 3);
+    const point_type_fp p1(i * 19 % 29 - 1, i * 23 % 41 - 4);
+    // A tree of one segment just tests that segment.
+    bool expected = false;
+    for (const auto& segment : segments) {
+      expected = expected || SegmentTree({segment}).intersects(p0, p1);
+    }
+    BOOST_CHECK_EQUAL(tree.intersects(p0, p1), expected);
+  }
+  BOOST_CHECK(!SegmentTree().intersects({0, 0}, {1, 1}));
+}
 BOOST_AUTO_TEST_SUITE_END()
@@ -24,6 +24,7 @@ using std::unordered_set;
 using std::unordered_map;
 
 #include <fstream>
+#include <sstream>
 #include <limits>
 using std::numeric_limits;
 
@@ -41,6 +42,7 @@ using std::vector;
 #include <algorithm>
 #include <iostream>
 #include <cmath>
+#include <chrono>
 using std::cerr;
 using std::endl;
 
@@ -68,46 +70,84 @@ using boost::make_optional;
 #include "backtrack.hpp"
 #include "bg_operators.hpp"
 #include "bg_helpers.hpp"
+#include "profile.hpp"
+#include "geometry_cache.hpp"
 #include "units.hpp"
 #include "path_finding.hpp"
 #include "trim_paths.hpp"
 #include "svg_writer.hpp"
 #include "disjoint_set.hpp"
+#include "path_connections.hpp"
+#include "merge_near_points.hpp"
 
 using std::max;
 using std::max_element;
 using std::next;
 using std::dynamic_pointer_cast;
+using bg_helpers::LazyMultiPolygon;
 
 unsigned int Surface_vectorial::debug_image_index = 0;
+std::mutex Surface_vectorial::debug_image_mutex;
+std::mutex Surface_vectorial::voronoi_memo_mutex;
+unordered_map<string, multi_polygon_type_fp> Surface_vectorial::voronoi_memo;
 
 Surface_vectorial::Surface_vectorial(unsigned int points_per_circle,
                                      const box_type_fp& bounding_box,
-                                     string name, string outputdir,
-                                     bool tsp_2opt, MillFeedDirection::MillFeedDirection mill_feed_direction,
-                                     bool invert_gerbers, bool render_paths_to_shapes) :
+                                     string name, string outputdir, string cache_dir,
+                                     bool tsp_2opt, size_t tsp_2opt_neighbours, double tsp_time_limit,
+                                     MillFeedDirection::MillFeedDirection mill_feed_direction,
+                                     bool invert_gerbers, bool render_paths_to_shapes,
+                                     shared_ptr<ThreadPool> thread_pool) :
     points_per_circle(points_per_circle),
     bounding_box(bounding_box),
     name(name),
     outputdir(outputdir),
+    cache_dir(cache_dir),
     tsp_2opt(tsp_2opt),
+    tsp_2opt_neighbours(tsp_2opt_neighbours),
+    tsp_time_limit(tsp_time_limit),
     fill(false),
     mill_feed_direction(mill_feed_direction),
     invert_gerbers(invert_gerbers),
-    render_paths_to_shapes(render_paths_to_shapes) {}
+    render_paths_to_shapes(render_paths_to_shapes),
+    thread_pool(thread_pool) {}
 
 void Surface_vectorial::render(shared_ptr<GerberImporter> importer, double tolerance) {
-  auto vectorial_surface_not_simplified = importer->render(fill, render_paths_to_shapes, points_per_circle);
+  profile::Timer timer("Surface_vectorial::render");
+  // The key is a hash of everything that affects the rendered surface.
+  geometry_cache::Hash key;
+  const bool use_cache = !cache_dir.empty() && key.add_file(importer->get_path());
+  key.add(fill).add(render_paths_to_shapes).add(points_per_circle).add(tolerance);
+  key.add(int(default_merge_algorithm()));
+  bool self_intersecting = false;
+  vectorial_surface = make_shared<
+      pair<multi_polygon_type_fp, map<coordinate_type_fp, multi_linestring_type_fp>>>();
+  if (use_cache &&
+      geometry_cache::load(cache_dir, "render", key.hex(),
+                           self_intersecting, vectorial_surface->first, vectorial_surface->second)) {
+    profile::count("Surface_vectorial::render", "cache hits");
+  } else {
+    vectorial_surface = make_shared<
+        pair<multi_polygon_type_fp, map<coordinate_type_fp, multi_linestring_type_fp>>>();
+    self_intersecting = render_uncached(importer, tolerance);
+    if (use_cache) {
+      geometry_cache::store(cache_dir, "render", key.hex(),
+                            self_intersecting, vectorial_surface->first, vectorial_surface->second);
+    }
+  }
 
-  if (bg::intersects(vectorial_surface_not_simplified.first)) {
+  if (self_intersecting) {
     cerr << "\nWarning: Geometry of layer '" << name << "' is"
         " self-intersecting. This can cause pcb2gcode to produce"
         " wildly incorrect toolpaths. You may want to check the"
         " g-code output and/or fix your gerber files!\n";
   }
+}
+
+bool Surface_vectorial::render_uncached(shared_ptr<GerberImporter> importer, double tolerance) {
+  auto vectorial_surface_not_simplified = importer->render(fill, render_paths_to_shapes, points_per_circle);
+  const bool self_intersecting = bg::intersects(vectorial_surface_not_simplified.first);
 
-  vectorial_surface = make_shared<
-      pair<multi_polygon_type_fp, map<coordinate_type_fp, multi_linestring_type_fp>>>();
   if (tolerance > 0) {
     //With a very small loss of precision we can reduce memory usage and processing time
     bg::simplify(vectorial_surface_not_simplified.first, vectorial_surface->first, tolerance);
@@ -124,6 +164,7 @@ void Surface_vectorial::render(shared_ptr<GerberImporter> importer, double toler
       vectorial_surface->second[diameter_and_path.first].swap(diameter_and_path.second);
     }
   }
+  return self_intersecting;
 }
 
 // If the direction is ccw, return cw and vice versa.  If any, return any.
@@ -178,6 +219,12 @@ vector<polygon_type_fp> find_thermal_reliefs(const multi_polygon_type_fp& millin
   return holes;
 }
 
+static void print_contentions_warning() {
+  cerr << "\nWarning: pcb2gcode hasn't been able to fulfill all"
+      " clearance requirements.  Check the contentions output"
+      " and consider using a smaller milling bit.\n";
+}
+
 void Surface_vectorial::write_svgs(const std::string& tool_suffix, coordinate_type_fp tool_diameter,
                 const multi_linestring_type_fp& toolpaths,
                 coordinate_type_fp tolerance, bool find_contentions) const {
@@ -192,9 +239,14 @@ void Surface_vectorial::write_svgs(const std::string& tool_suffix, coordinate_ty
 void Surface_vectorial::write_svgs(const string& tool_suffix, coordinate_type_fp tool_diameter,
                                    const vector<vector<pair<linestring_type_fp, bool>>>& new_trace_toolpaths,
                                    coordinate_type_fp tolerance, bool find_contentions) const {
+  std::lock_guard<std::mutex> lock(debug_image_mutex);
   // Now set up the debug images, one per tool.
-  svg_writer debug_image(build_filename(outputdir, "processed_" + name + tool_suffix + ".svg"), bounding_box);
-  svg_writer traced_debug_image(build_filename(outputdir, "traced_" + name + tool_suffix + ".svg"), bounding_box);
+  const string debug_filename = "processed_" + name + tool_suffix + ".svg";
+  const string traced_filename = "traced_" + name + tool_suffix + ".svg";
+  svg_writer debug_image(build_filename(outputdir, debug_filename), bounding_box);
+  svg_writer traced_debug_image(build_filename(outputdir, traced_filename), bounding_box);
+  written_svgs.push_back(debug_filename);
+  written_svgs.push_back(traced_filename);
   optional<svg_writer> contentions_image;
   srand(1);
   debug_image.add(voronoi, 0.2, false);
@@ -221,7 +273,9 @@ void Surface_vectorial::write_svgs(const string& tool_suffix, coordinate_type_fp
         temp2 = temp2 & temp;
         if (bg::length(temp2) > 0) {
           if (!contentions_image) {
-            contentions_image.emplace(build_filename(outputdir, "contentions_" + name + tool_suffix + ".svg"), bounding_box);
+            const string contentions_filename = "contentions_" + name + tool_suffix + ".svg";
+            contentions_image.emplace(build_filename(outputdir, contentions_filename), bounding_box);
+            written_svgs.push_back(contentions_filename);
           }
           contentions_image->add(temp2, tool_diameter, 255, 0, 0);
         }
@@ -229,9 +283,7 @@ void Surface_vectorial::write_svgs(const string& tool_suffix, coordinate_type_fp
     }
   }
   if (contentions_image) {
-    cerr << "\nWarning: pcb2gcode hasn't been able to fulfill all"
-        " clearance requirements.  Check the contentions output"
-        " and consider using a smaller milling bit.\n";
+    print_contentions_warning();
   }
   srand(1);
   debug_image.add(vectorial_surface->first, 1, true);
@@ -258,9 +310,12 @@ vector<pair<linestring_type_fp, bool>> full_eulerian_paths(
   for (const auto& p : paths_to_add) {
     toolpath1.push_back(p);
   }
-  toolpath1 = eulerian_paths::get_eulerian_paths<
-    point_type_fp,
-    linestring_type_fp>(toolpath1);
+  {
+    profile::Timer timer("eulerian_paths");
+    toolpath1 = eulerian_paths::get_eulerian_paths<
+      point_type_fp,
+      linestring_type_fp>(toolpath1);
+  }
   trim_paths::trim_paths(toolpath1, paths_to_add);
   return toolpath1;
 }
@@ -291,10 +346,17 @@ multi_linestring_type_fp Surface_vectorial::post_process_toolpath(
   }
   shared_ptr<Isolator> isolator = dynamic_pointer_cast<Isolator>(mill);
   if (isolator != nullptr) {
+    profile::Timer timer("tsp");
+    profile::count("tsp", "paths", combined_toolpath.size());
     if (tsp_2opt) {
-      tsp_solver::tsp_2opt(combined_toolpath, point_type_fp(0, 0));
+      tsp_solver::tsp_2opt(combined_toolpath, point_type_fp(0, 0), tsp_2opt_neighbours).count("tsp", "2opt");
     } else {
-      tsp_solver::nearest_neighbour(combined_toolpath, point_type_fp(0, 0));
+      tsp_solver::nearest_neighbour_kd_tree(combined_toolpath, point_type_fp(0, 0));
+    }
+    if (tsp_time_limit > 0) {
+      tsp_solver::tsp_improve(combined_toolpath, point_type_fp(0, 0),
+                              std::chrono::duration<double>(tsp_time_limit))
+          .count("tsp", "improve");
     }
   } else {
     // It's a cutter so do the cuts from shortest to longest.  This
@@ -483,21 +545,32 @@ bool attach_ls(const linestring_type_fp& ls,
   return true;
 }
 
+// Only the toolpaths with an endpoint that the path finder might reach
+// are tried, in the same order as toolpaths.  endpoints must index
+// toolpaths and is kept up to date.
 void attach_ls(const linestring_type_fp& ls,
                vector<pair<linestring_type_fp, bool>>& toolpaths,
+               path_connections::EndpointIndex& endpoints,
                const MillFeedDirection::MillFeedDirection& dir,
                const Surface_vectorial::PathFinder& path_finder) {
   if (bg::equals(ls.front(), ls.back())) {
     // This path is actually a ring so we can use attach_ring which can connect
     // at any point.
-    for (auto& toolpath : toolpaths) {
-      if (attach_ring(ls, toolpath, dir, path_finder)) {
+    for (const auto i : endpoints.near(bg::return_envelope<box_type_fp>(ls))) {
+      if (attach_ring(ls, toolpaths[i], dir, path_finder)) {
+        endpoints.update(i);
         return;
       }
     }
   } else {
-    for (auto& toolpath : toolpaths) {
-      if (attach_ls(ls, toolpath, dir, path_finder)) {
+    auto candidates = endpoints.near(box_type_fp(ls.front(), ls.front()));
+    const auto near_back = endpoints.near(box_type_fp(ls.back(), ls.back()));
+    candidates.insert(candidates.end(), near_back.cbegin(), near_back.cend());
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+    for (const auto i : candidates) {
+      if (attach_ls(ls, toolpaths[i], dir, path_finder)) {
+        endpoints.update(i);
         return; // Done, we were able to attach to an existing toolpath.
       }
     }
@@ -510,17 +583,19 @@ void attach_ls(const linestring_type_fp& ls,
   } else {
     toolpaths.push_back(make_pair(linestring_type_fp(ls.cbegin(), ls.cend()), true)); // true for reversible
   }
+  endpoints.add();
 }
 
 void attach_mls(const multi_linestring_type_fp& mls,
                 vector<pair<linestring_type_fp, bool>>& toolpaths,
+                path_connections::EndpointIndex& endpoints,
                 const MillFeedDirection::MillFeedDirection& dir,
                 const multi_polygon_type_fp& already_milled_shrunk,
                 const Surface_vectorial::PathFinder& path_finder) {
   auto mls_masked = mls - already_milled_shrunk;  // This might chop the single path into many paths.
   mls_masked = eulerian_paths::make_eulerian_paths(mls_masked, dir == MillFeedDirection::ANY, false); // Rejoin those paths as possible.
   for (const auto& ls : mls_masked) { // Maybe more than one if the masking cut one into parts.
-    attach_ls(ls, toolpaths, dir, path_finder);
+    attach_ls(ls, toolpaths, endpoints, dir, path_finder);
   }
 }
 
@@ -654,6 +729,7 @@ static void add_spikes(ring_type_fp& ring, coordinate_type_fp offset,
 // to the list of toolpaths.  offset is the tool diameter minus the overlap requested.
 void attach_ring(const ring_type_fp& ring,
                  vector<pair<linestring_type_fp, bool>>& toolpaths,
+                 path_connections::EndpointIndex& endpoints,
                  const MillFeedDirection::MillFeedDirection& dir,
                  const multi_polygon_type_fp& already_milled_shrunk,
                  const Surface_vectorial::PathFinder& path_finder,
@@ -666,7 +742,7 @@ void attach_ring(const ring_type_fp& ring,
   add_spikes(ring_copy, spike_offset, reverse_spikes, tolerance, spikes_keep_in, spikes_keep_out);
   multi_linestring_type_fp ring_paths;
   ring_paths.push_back(linestring_type_fp(ring_copy.cbegin(), ring_copy.cend())); // Make a copy into an mls.
-  attach_mls(ring_paths, toolpaths, dir, already_milled_shrunk, path_finder);
+  attach_mls(ring_paths, toolpaths, endpoints, dir, already_milled_shrunk, path_finder);
 }
 
 // Given polygons, attach all the rings inside to the toolpaths.  path_finder is
@@ -674,6 +750,7 @@ void attach_ring(const ring_type_fp& ring,
 // possible, as in, not too long and doesn't cross any traces, etc.
 void attach_polygons(const multi_polygon_type_fp& polygons,
                      vector<pair<linestring_type_fp, bool>>& toolpaths,
+                     path_connections::EndpointIndex& endpoints,
                      const MillFeedDirection::MillFeedDirection& dir,
                      const multi_polygon_type_fp& already_milled_shrunk,
                      const Surface_vectorial::PathFinder& path_finder,
@@ -685,7 +762,7 @@ void attach_polygons(const multi_polygon_type_fp& polygons,
   // Loop through the polygons by ring index because that will lead to better
   // connections between loops.
   for (const auto& poly : polygons) {
-    attach_ring(poly.outer(), toolpaths, dir, already_milled_shrunk,
+    attach_ring(poly.outer(), toolpaths, endpoints, dir, already_milled_shrunk,
                 path_finder, spike_offset, reverse_spikes, tolerance,
                 spikes_keep_in, spikes_keep_out);
   }
@@ -695,7 +772,7 @@ void attach_polygons(const multi_polygon_type_fp& polygons,
     for (const auto& poly : polygons) {
       if (poly.inners().size() > i) {
         found_one = true;
-        attach_ring(poly.inners()[i], toolpaths, dir, already_milled_shrunk,
+        attach_ring(poly.inners()[i], toolpaths, endpoints, dir, already_milled_shrunk,
                     path_finder, spike_offset, reverse_spikes, tolerance,
                     spikes_keep_in, spikes_keep_out);
       }
@@ -727,6 +804,29 @@ Surface_vectorial::PathFinder Surface_vectorial::make_path_finder(
          };
 }
 
+// Returns the longest distance that the path finders might be able to
+// connect for this mill.  Any two points that are farther apart than
+// this will never be connected because retracting, moving and plunging
+// is always faster.
+static coordinate_type_fp max_path_finding_distance(const shared_ptr<RoutingMill>& mill) {
+  // The path finders allow a path as long as:
+  //   k * (c + max_manhattan/g0_horizontal_speed)
+  // where max_manhattan is at most the distance between the points.
+  const auto vertical_distance = mill->zsafe - mill->zwork;
+  const double horizontalG1speed = mill->feed;
+  const double c = vertical_distance/mill->g0_vertical_speed + vertical_distance/mill->vertfeed;
+  const double k = std::isinf(mill->backtrack) ?
+      horizontalG1speed :
+      mill->backtrack / (1 + mill->backtrack/horizontalG1speed);
+  const double ratio = k / mill->g0_horizontal_speed;
+  if (!(ratio < 1) || !(c >= 0)) {
+    // G0 isn't faster than milling so any distance might be worth it.
+    return numeric_limits<coordinate_type_fp>::infinity();
+  }
+  // Allow some slack for rounding errors.
+  return k * c / (1 - ratio) * (1 + 1e-6);
+}
+
 Surface_vectorial::PathFinderRingIndices Surface_vectorial::make_path_finder_ring_indices(
     shared_ptr<RoutingMill> mill,
     const path_finding::PathFindingSurface& path_finding_surface) const {
@@ -815,6 +915,7 @@ vector<pair<linestring_type_fp, bool>> Surface_vectorial::get_single_toolpath(
     // Each linestring has a bool attached to it indicating if it is reversible.
     // true means reversal is still allowed.
     vector<pair<linestring_type_fp, bool>> toolpath;
+    path_connections::EndpointIndex endpoints(toolpath, max_path_finding_distance(mill));
     for (size_t polygon_index = 0; polygon_index < polygons.size(); polygon_index++) {
       const auto& polygon = polygons[polygon_index];
       MillFeedDirection::MillFeedDirection dir = mill_feed_direction;
@@ -865,7 +966,7 @@ vector<pair<linestring_type_fp, bool>> Surface_vectorial::get_single_toolpath(
           }
         }
       }
-      attach_polygons(polygon, toolpath, dir, already_milled_shrunk, path_finder,
+      attach_polygons(polygon, toolpath, endpoints, dir, already_milled_shrunk, path_finder,
                       spike_offset, reverse_spikes, mill->tolerance,
                       spikes_keep_in, spikes_keep_out);
     }
@@ -881,58 +982,28 @@ vector<pair<linestring_type_fp, bool>> Surface_vectorial::final_path_finder(
     const std::shared_ptr<RoutingMill>& mill,
     const path_finding::PathFindingSurface& path_finding_surface,
     const vector<pair<linestring_type_fp, bool>>& paths) const {
-  // Find all the connectable endpoints.  A connection can only be
-  // made if the direction suits it.  connections is the list of
-  // possible connections to make.  It is a tuple of (distance between
-  // points, point0, point1, path0, path1).  The path indicates an
-  // index into the paths, and says which path was the cause for
-  // adding the point.  We want to know it so that we don't make
-  // connections between paths that are already connected.
-  vector<tuple<coordinate_type_fp, point_type_fp, point_type_fp, size_t, size_t>> connections;
-  for (size_t i = 0; i < paths.size(); i++) {
-    const auto& path1 = paths[i];
-    for (size_t j = i+1; j < paths.size(); j++) {
-      const auto& path2 = paths[j];
-      // We can always do these:
-      connections.push_back({bg::distance(path1.first.back(), path2.first.front()),
-                             path1.first.back(), path2.first.front(), i, j});
-      connections.push_back({bg::distance(path1.first.front(), path2.first.back()),
-                             path1.first.back(), path2.first.front(), i, j});
-      if (path1.second) {
-        // path1 is reversible so we can connect from the front of it.
-        connections.push_back({bg::distance(path1.first.front(), path2.first.front()),
-                               path1.first.front(), path2.first.front(), i, j});
-      }
-      if (path2.second) {
-        // path2 is reversible so we can connect from the front of it.
-        connections.push_back({bg::distance(path1.first.back(), path2.first.back()),
-                               path1.first.back(), path2.first.back(), i, j});
-      }
-    }
-  }
-  // Sort so that the closest pairs are first.
-  std::sort(connections.begin(), connections.end());
-  // Find to which polygon each point belongs.  Each one stores an index into all_rind_indices;
+  // Find to which polygon each endpoint belongs.  Each one stores an index into all_rind_indices;
   unordered_map<point_type_fp, boost::optional<path_finding::SearchKey>> points_to_poly_id;
-  for (const auto& c : connections) {
-    if (points_to_poly_id.count(get<1>(c)) == 0) {
-      // New point, need to add it.
-      points_to_poly_id.emplace(get<1>(c), path_finding_surface.in_surface(get<1>(c)));
-    }
-    if (points_to_poly_id.count(get<2>(c)) == 0) {
-      // New point, need to add it.
-      points_to_poly_id.emplace(get<2>(c), path_finding_surface.in_surface(get<2>(c)));
+  for (const auto& path : paths) {
+    for (const auto& p : {path.first.front(), path.first.back()}) {
+      if (points_to_poly_id.count(p) == 0) {
+        // New point, need to add it.
+        points_to_poly_id.emplace(p, path_finding_surface.in_surface(p));
+      }
     }
   }
 
   vector<pair<linestring_type_fp, bool>> new_paths;
   PathFinderRingIndices path_finder = make_path_finder_ring_indices(mill, path_finding_surface);
   DisjointSet<size_t> joined_paths;
-  for (const auto& start_end : connections) {
-    const point_type_fp& start = get<1>(start_end);
-    const point_type_fp& end = get<2>(start_end);
-    size_t start_path = get<3>(start_end);
-    size_t end_path = get<4>(start_end);
+  // Try the possible connections from closest to farthest.  A
+  // connection can only be made if the direction suits it.
+  path_connections::ConnectionFinder connections(paths, max_path_finding_distance(mill));
+  while (const auto connection = connections.next()) {
+    const point_type_fp& start = connection->start;
+    const point_type_fp& end = connection->end;
+    size_t start_path = connection->start_path;
+    size_t end_path = connection->end_path;
     const auto& start_ring_indices = points_to_poly_id.at(start);
     const auto& end_ring_indices = points_to_poly_id.at(end);
     if (!start_ring_indices ||
@@ -952,9 +1023,81 @@ vector<pair<linestring_type_fp, bool>> Surface_vectorial::final_path_finder(
   return new_paths;
 }
 
+multi_polygon_type_fp Surface_vectorial::build_voronoi(coordinate_type_fp tolerance, unsigned int tiles,
+                                                       coordinate_type_fp reach) const {
+  string surface;
+  geometry_cache::write(surface, vectorial_surface->first);
+  geometry_cache::Hash hash;
+  hash.add(surface).add(tolerance).add(tiles).add(reach);
+  hash.add(bounding_box.min_corner().x()).add(bounding_box.min_corner().y());
+  hash.add(bounding_box.max_corner().x()).add(bounding_box.max_corner().y());
+  const string key = hash.hex();
+  {
+    std::lock_guard<std::mutex> lock(voronoi_memo_mutex);
+    const auto found = voronoi_memo.find(key);
+    if (found != voronoi_memo.cend()) {
+      profile::count("build_voronoi", "memo hits");
+      return found->second;
+    }
+  }
+  multi_polygon_type_fp result;
+  if (!cache_dir.empty() && geometry_cache::load(cache_dir, "voronoi", key, result)) {
+    profile::count("build_voronoi", "cache hits");
+  } else {
+    result = Voronoi::build_voronoi(vectorial_surface->first, bounding_box, tolerance, tiles, thread_pool, reach);
+    if (!cache_dir.empty()) {
+      geometry_cache::store(cache_dir, "voronoi", key, result);
+    }
+  }
+  std::lock_guard<std::mutex> lock(voronoi_memo_mutex);
+  voronoi_memo.emplace(key, result);
+  return result;
+}
+
+string Surface_vectorial::toolpath_cache_key(const RoutingMill& mill, bool mirror, bool ymirror) const {
+  geometry_cache::Hash key;
+  string surface;
+  geometry_cache::write(surface, vectorial_surface->first);
+  geometry_cache::write(surface, vectorial_surface->second);
+  if (mask) {
+    geometry_cache::write(surface, mask->vectorial_surface->first);
+  }
+  key.add(surface);
+  key.add(name);
+  key.add(bounding_box.min_corner().x()).add(bounding_box.min_corner().y());
+  key.add(bounding_box.max_corner().x()).add(bounding_box.max_corner().y());
+  key.add(bool(mask)).add(mirror).add(ymirror).add(invert_gerbers).add(int(mill_feed_direction));
+  key.add(tsp_2opt).add(tsp_2opt_neighbours).add(tsp_time_limit);
+  key.add(int(default_merge_algorithm()));
+  // The feeds and heights are needed because backtracking and path
+  // finding compare the time of milling with the time of moving up
+  // and over.
+  key.add(mill.feed).add(mill.vertfeed).add(mill.zsafe).add(mill.zwork);
+  key.add(mill.g0_vertical_speed).add(mill.g0_horizontal_speed);
+  key.add(mill.tolerance).add(mill.optimise).add(mill.eulerian_paths);
+  key.add(mill.path_finding_limit).add(mill.backtrack).add(mill.offset);
+  if (tsp_time_limit > 0) {
+    // The passes are part of the cost of tsp_improve.
+    key.add(mill.stepsize);
+  }
+  if (auto isolator = dynamic_cast<const Isolator*>(&mill)) {
+    key.add(string("isolator"));
+    for (const auto& tool : isolator->tool_diameters_and_overlap_widths) {
+      key.add(tool.first).add(tool.second);
+    }
+    key.add(isolator->extra_passes).add(isolator->voronoi).add(isolator->voronoi_tiles);
+    key.add(isolator->preserve_thermal_reliefs).add(isolator->isolation_width);
+  } else if (auto cutter = dynamic_cast<const Cutter*>(&mill)) {
+    key.add(string("cutter")).add(cutter->tool_diameter);
+  }
+  return key.hex();
+}
+
 // A bunch of pairs.  Each pair is the tool diameter followed by a vector of paths to mill.
 vector<pair<coordinate_type_fp, multi_linestring_type_fp>> Surface_vectorial::get_toolpath(
     shared_ptr<RoutingMill> mill, bool mirror, bool ymirror) {
+  // The key is computed first because the surface is modified below.
+  const string key = cache_dir.empty() ? "" : toolpath_cache_key(*mill, mirror, ymirror);
   bg::unique(vectorial_surface->first);
   for (auto& diameter_and_path : vectorial_surface->second) {
     bg::unique(diameter_and_path.second);
@@ -962,11 +1105,57 @@ vector<pair<coordinate_type_fp, multi_linestring_type_fp>> Surface_vectorial::ge
   if (invert_gerbers) {
     vectorial_surface->first = bounding_box - vectorial_surface->first;
   }
-  const auto tolerance = mill->tolerance;
-  // Get the voronoi region for each trace.
-  voronoi = Voronoi::build_voronoi(vectorial_surface->first, bounding_box, tolerance);
+  if (key.empty()) {
+    return get_toolpath_uncached(mill, mirror, ymirror);
+  }
+
+  vector<pair<coordinate_type_fp, multi_linestring_type_fp>> results;
+  // The svg files are part of the output so they are cached, too.
+  vector<pair<string, string>> svgs;
+  if (geometry_cache::load(cache_dir, "toolpath", key, results, svgs)) {
+    profile::count("Surface_vectorial::get_toolpath", "cache hits");
+    bool contentions = false;
+    for (const auto& filename_and_contents : svgs) {
+      std::ofstream file(build_filename(outputdir, filename_and_contents.first), std::ios::binary);
+      file << filename_and_contents.second;
+      contentions = contentions || filename_and_contents.first.compare(0, 12, "contentions_") == 0;
+    }
+    if (contentions) {
+      print_contentions_warning();
+    }
+    return results;
+  }
+  written_svgs.clear();
+  results = get_toolpath_uncached(mill, mirror, ymirror);
+  for (const auto& filename : written_svgs) {
+    std::ifstream file(build_filename(outputdir, filename), std::ios::binary);
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    svgs.push_back(make_pair(filename, contents.str()));
+  }
+  geometry_cache::store(cache_dir, "toolpath", key, results, svgs);
+  return results;
+}
 
+vector<pair<coordinate_type_fp, multi_linestring_type_fp>> Surface_vectorial::get_toolpath_uncached(
+    shared_ptr<RoutingMill> mill, bool mirror, bool ymirror) {
+  const auto tolerance = mill->tolerance;
   auto isolator = dynamic_pointer_cast<Isolator>(mill);
+  // Get the voronoi region for each trace.  They only need to be
+  // exact as far from the bounding box as the isolation can reach.
+  // This is more than the outermost pass of any tool, which is less
+  // than the isolation width or the extra passes from the tool's edge.
+  coordinate_type_fp reach = std::numeric_limits<coordinate_type_fp>::infinity();
+  if (isolator) {
+    reach = 0;
+    for (const auto& tool : isolator->tool_diameters_and_overlap_widths) {
+      reach = std::max(reach, tool.first + std::max(isolator->isolation_width,
+                                                    (tool.first - tool.second) * isolator->extra_passes));
+    }
+    reach += std::abs(mill->offset);
+  }
+  voronoi = build_voronoi(tolerance, isolator ? isolator->voronoi_tiles : 1, reach);
+
   if (isolator) {
     if (isolator->preserve_thermal_reliefs && isolator->voronoi) {
       thermal_holes = find_thermal_reliefs(vectorial_surface->first, tolerance);
@@ -987,7 +1176,10 @@ vector<pair<coordinate_type_fp, multi_linestring_type_fp>> Surface_vectorial::ge
         keep_outs.push_back(bg_helpers::buffer(poly, tool_diameter/2 + isolator->offset));
       }
       const auto path_finding_surface = path_finding::PathFindingSurface(mask ? boost::make_optional(mask->vectorial_surface->first) : boost::none, sum(keep_outs), isolator->tolerance);
-      for (size_t trace_index = 0; trace_index < trace_count; trace_index++) {
+      // Each trace only reads and writes its own entry in
+      // already_milled and new_trace_toolpaths so they can all be
+      // computed at the same time.
+      thread_pool->parallel_for(trace_count, [&](size_t trace_index) {
         multi_polygon_type_fp already_milled_shrunk =
             bg_helpers::buffer(already_milled[trace_index], -tool_diameter/2 + tolerance);
         if (tool_index < tool_count - 1) {
@@ -1019,7 +1211,7 @@ vector<pair<coordinate_type_fp, multi_linestring_type_fp>> Surface_vectorial::ge
         new_trace_toolpaths[trace_index] = new_trace_toolpath;
         if (tool_index + 1 == tool_count) {
           // No point in updating the already_milled.
-          continue;
+          return;
         }
         multi_linestring_type_fp combined_trace_toolpath;
         combined_trace_toolpath.reserve(new_trace_toolpath.size());
@@ -1029,7 +1221,7 @@ vector<pair<coordinate_type_fp, multi_linestring_type_fp>> Surface_vectorial::ge
         multi_polygon_type_fp new_trace_toolpath_bufferred =
             bg_helpers::buffer(combined_trace_toolpath, tool_diameter/2);
         already_milled[trace_index] = already_milled[trace_index] + new_trace_toolpath_bufferred;
-      }
+      });
 
       const string tool_suffix = tool_count > 1 ? "_" + std::to_string(tool_index) : "";
       write_svgs(tool_suffix, tool_diameter, new_trace_toolpaths, isolator->tolerance, tool_index == tool_count - 1);
@@ -1049,8 +1241,10 @@ vector<pair<coordinate_type_fp, multi_linestring_type_fp>> Surface_vectorial::ge
           [&](const point_type_fp&, const point_type_fp&) -> optional<linestring_type_fp> {
             return boost::none;
           };
+      // The path finder never connects anything so there is no reach.
+      path_connections::EndpointIndex endpoints(new_trace_toolpath, 0);
       for (const auto& path : paths) {
-        attach_ls(path, new_trace_toolpath, MillFeedDirection::ANY, path_finder);
+        attach_ls(path, new_trace_toolpath, endpoints, MillFeedDirection::ANY, path_finder);
       }
       const string tool_suffix = "_lines_" + std::to_string(tool_diameter);
       write_svgs(tool_suffix, tool_diameter, {new_trace_toolpath}, mill->tolerance, false);
@@ -1065,10 +1259,9 @@ vector<pair<coordinate_type_fp, multi_linestring_type_fp>> Surface_vectorial::ge
     const auto trace_count = vectorial_surface->first.size();
     vector<vector<pair<linestring_type_fp, bool>>> new_trace_toolpaths(trace_count);
 
-    for (size_t trace_index = 0; trace_index < trace_count; trace_index++) {
-      const auto new_trace_toolpath = get_single_toolpath(cutter, trace_index, mirror, cutter->tool_diameter, 0, multi_polygon_type_fp(), path_finding_surface);
-      new_trace_toolpaths[trace_index] = new_trace_toolpath;
-    }
+    thread_pool->parallel_for(trace_count, [&](size_t trace_index) {
+      new_trace_toolpaths[trace_index] = get_single_toolpath(cutter, trace_index, mirror, cutter->tool_diameter, 0, multi_polygon_type_fp(), path_finding_surface);
+    });
     write_svgs("", cutter->tool_diameter, new_trace_toolpaths, mill->tolerance, false);
     auto new_toolpath = flatten(new_trace_toolpaths);
     multi_linestring_type_fp combined_toolpath = post_process_toolpath(cutter, boost::none, new_toolpath);
@@ -1079,6 +1272,7 @@ vector<pair<coordinate_type_fp, multi_linestring_type_fp>> Surface_vectorial::ge
 
 void Surface_vectorial::save_debug_image(string message)
 {
+    std::lock_guard<std::mutex> lock(debug_image_mutex);
     const string filename = (boost::format("outp%d_%s.svg") % debug_image_index % message).str();
     svg_writer debug_image(build_filename(outputdir, filename), bounding_box);
 
@@ -1127,6 +1321,7 @@ vector<multi_polygon_type_fp> Surface_vectorial::offset_polygon(
     coordinate_type_fp overlap,
     unsigned int steps, bool do_voronoi,
     coordinate_type_fp offset) const {
+  profile::Timer timer("offset_polygon");
   // The polygons to add to the PNG debugging output files.
   // Mask the polygon that we need to mill.
   multi_polygon_type_fp milling_poly{do_voronoi ? voronoi_polygon : *input};  // Milling voronoi or trace?
@@ -1136,15 +1331,6 @@ vector<multi_polygon_type_fp> Surface_vectorial::offset_polygon(
     // slightly to accommodate the thickness of the millbit.
     thermal_offset = -diameter/2 - offset;
   }
-  // This is the area that the milling must not cross so that it
-  // doesn't dig into the trace.  We only need this if there is an
-  // input which is not the case if this is a thermal hole.
-  multi_polygon_type_fp path_minimum;
-  if (input) {
-    path_minimum = bg_helpers::buffer(*input, diameter/2 + offset);
-  }
-
-  auto voronoi_shrunk = (bg_helpers::buffer(voronoi_polygon, -diameter/2 + overlap/2) + path_minimum) & voronoi_polygon;
   // We need to crop the area that we'll mill if it extends outside the PCB's
   // outline.  This saves time in milling.
   if (mask) {
@@ -1162,6 +1348,28 @@ vector<multi_polygon_type_fp> Surface_vectorial::offset_polygon(
       bg::buffer(bounding_box, new_bounding_box, diameter / 2 + (diameter - overlap) * (steps - 1));
     }
   }
+  // All the passes are buffers of the same milling_poly.
+  bg_helpers::MultiBuffer milling_buffers(milling_poly);
+  // These are used in every pass so they're only converted once.
+  const LazyMultiPolygon lazy_voronoi(multi_polygon_type_fp{voronoi_polygon});
+  multi_polygon_type_fp bounding_box_mp;
+  bg::convert(bounding_box, bounding_box_mp);
+  const LazyMultiPolygon lazy_bounding_box(bounding_box_mp);
+
+  // This is the area that the milling must not cross so that it
+  // doesn't dig into the trace.  We only need this if there is an
+  // input which is not the case if this is a thermal hole.
+  LazyMultiPolygon path_minimum;
+  if (input) {
+    if (!do_voronoi && !mask) {
+      // The milling_poly is the input so this is also the first pass.
+      path_minimum = milling_buffers(diameter/2 + offset);
+    } else {
+      path_minimum = LazyMultiPolygon(multi_polygon_type_fp{*input}).buffer(diameter/2 + offset);
+    }
+  }
+
+  auto voronoi_shrunk = (lazy_voronoi.buffer(-diameter/2 + overlap/2) + path_minimum) & lazy_voronoi;
 
   vector<multi_polygon_type_fp> polygons;
   // Convert the input shape into a bunch of rings that need to be milled.
@@ -1188,7 +1396,7 @@ vector<multi_polygon_type_fp> Surface_vectorial::offset_polygon(
       expand_by = (diameter - overlap) * factor;
     }
 
-    multi_polygon_type_fp buffered_milling_poly = bg_helpers::buffer(milling_poly, expand_by + offset + thermal_offset);
+    LazyMultiPolygon buffered_milling_poly = milling_buffers(expand_by + offset + thermal_offset);
     if (expand_by + offset != 0) {
       if (!do_voronoi) {
         buffered_milling_poly = buffered_milling_poly & voronoi_shrunk;
@@ -1196,21 +1404,24 @@ vector<multi_polygon_type_fp> Surface_vectorial::offset_polygon(
         buffered_milling_poly = buffered_milling_poly + path_minimum;
       }
     }
-    if (mask && !bg::covered_by(buffered_milling_poly, mask->vectorial_surface->first)) {
+    // The mask is the whole board so it's not converted for each
+    // polygon.  Instead, the pass is converted to check it.
+    if (mask && !bg::covered_by(buffered_milling_poly.get(), mask->vectorial_surface->first)) {
       // Don't mill outside the mask because that's a waste.
       // But don't mill into the trace itself.
       // And don't mill into other traces.
-      buffered_milling_poly = ((buffered_milling_poly & mask->vectorial_surface->first) + path_minimum) & voronoi_polygon;
+      buffered_milling_poly = (LazyMultiPolygon(buffered_milling_poly.get() & mask->vectorial_surface->first) +
+                               path_minimum) & lazy_voronoi;
     }
     if (invert_gerbers) {
-      buffered_milling_poly = buffered_milling_poly & bounding_box;
+      buffered_milling_poly = buffered_milling_poly & lazy_bounding_box;
     }
-    if (polygons.size() > 0 && bg::equals(buffered_milling_poly, polygons.back())) {
+    if (polygons.size() > 0 && bg::equals(buffered_milling_poly.get(), polygons.back())) {
       // Once we start getting repeats, we can expect that all the rest will be
       // the same so we're done.
       break;
     }
-    polygons.push_back(buffered_milling_poly);
+    polygons.push_back(buffered_milling_poly.get());
   }
 
   return polygons;
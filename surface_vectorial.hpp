@@ -24,12 +24,14 @@
 #include <list>
 #include <forward_list>
 #include <map>
+#include <unordered_map>
 #include <utility>
 #include <algorithm>
 
 #include <fstream>
 
 #include <memory>
+#include <mutex>
 
 #include <boost/noncopyable.hpp>
 #include <boost/optional.hpp>
@@ -39,6 +41,7 @@
 #include "voronoi.hpp"
 #include "units.hpp"
 #include "path_finding.hpp"
+#include "thread_pool.hpp"
 
 /******************************************************************************/
 /*
@@ -54,9 +57,11 @@ class Surface_vectorial: private boost::noncopyable {
 
   Surface_vectorial(unsigned int points_per_circle,
                     const box_type_fp& bounding_box,
-                    std::string name, std::string outputdir, bool tsp_2opt,
+                    std::string name, std::string outputdir, std::string cache_dir,
+                    bool tsp_2opt, size_t tsp_2opt_neighbours, double tsp_time_limit,
                     MillFeedDirection::MillFeedDirection mill_feed_direction,
-                    bool invert_gerbers, bool render_paths_to_shapes);
+                    bool invert_gerbers, bool render_paths_to_shapes,
+                    std::shared_ptr<ThreadPool> thread_pool);
 
   std::vector<std::pair<coordinate_type_fp, multi_linestring_type_fp>> get_toolpath(
       std::shared_ptr<RoutingMill> mill, bool mirror, bool ymirror);
@@ -81,23 +86,54 @@ protected:
   const box_type_fp bounding_box;
   const std::string name;
   const std::string outputdir;
+  // Where to cache rendered layers, or empty for no cache.
+  const std::string cache_dir;
   const bool tsp_2opt;
+  const size_t tsp_2opt_neighbours;
+  // Seconds to spend on tsp_improve, if any.
+  const double tsp_time_limit;
   static unsigned int debug_image_index;
+  // The debug images are colored using the global rand() so only one
+  // may be written at a time.
+  static std::mutex debug_image_mutex;
+  // Voronoi regions that were already computed in this run, by a hash
+  // of the inputs, because the same surface is often milled more than
+  // once.
+  static std::mutex voronoi_memo_mutex;
+  static std::unordered_map<std::string, multi_polygon_type_fp> voronoi_memo;
 
   bool fill;
   const MillFeedDirection::MillFeedDirection mill_feed_direction;
   const bool invert_gerbers;
   const bool render_paths_to_shapes;
+  // Used for computing the toolpaths of traces concurrently.
+  const std::shared_ptr<ThreadPool> thread_pool;
 
   std::shared_ptr<std::pair<multi_polygon_type_fp,
                       std::map<coordinate_type_fp, multi_linestring_type_fp>>>
       vectorial_surface;
   multi_polygon_type_fp voronoi;
   std::vector<polygon_type_fp> thermal_holes;
+  // The names of the svg files written by write_svgs, relative to
+  // outputdir, so that they can be cached with the toolpaths.
+  mutable std::vector<std::string> written_svgs;
 
 
   std::shared_ptr<Surface_vectorial> mask;
 
+  // Render into vectorial_surface.  Returns true if the rendered
+  // geometry is self-intersecting.
+  bool render_uncached(std::shared_ptr<GerberImporter> importer, double tolerance);
+  // Voronoi::build_voronoi of the surface, reusing an earlier result
+  // from this run or from the cache_dir if there is one.
+  multi_polygon_type_fp build_voronoi(coordinate_type_fp tolerance, unsigned int tiles,
+                                      coordinate_type_fp reach) const;
+  // A hash of the surface and of the options that affect its
+  // toolpaths.  Options that only change how the toolpaths are
+  // written to the G-code are not included.
+  std::string toolpath_cache_key(const RoutingMill& mill, bool mirror, bool ymirror) const;
+  std::vector<std::pair<coordinate_type_fp, multi_linestring_type_fp>> get_toolpath_uncached(
+      std::shared_ptr<RoutingMill> mill, bool mirror, bool ymirror);
   std::vector<std::pair<linestring_type_fp, bool>> get_single_toolpath(
       std::shared_ptr<RoutingMill> mill, const size_t trace_index, bool mirror, const double tool_diameter,
       const double overlap_width,
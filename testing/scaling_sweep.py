@@ -0,0 +1,109 @@
+#!/usr/bin/python3
+
+"""Run pcb2gcode on synthetic boards of increasing size.
+
+For each size, a board with that many nets is made with
+synthetic_board.py and milled with pcb2gcode --profile.  The wall
+time and peak memory of each run and the time of each stage are
+printed as a table, and optionally written as JSON, so that it's easy
+to see which stage stops scaling.
+
+Example:
+  testing/scaling_sweep.py --sizes 10,100,1000 --vias-per-net 2 -- --voronoi
+"""
+
+from __future__ import print_function
+import argparse
+import json
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+import synthetic_board
+
+def run(pcb2gcode, board_dir, pcb2gcode_args):
+  """Run pcb2gcode in board_dir and return the measurements."""
+  profile_path = os.path.join(board_dir, "profile.json")
+  cmd = [pcb2gcode, "--output-dir", board_dir, "--profile=" + profile_path] + pcb2gcode_args
+  start = time.time()
+  with open(os.path.join(board_dir, "pcb2gcode.log"), "w") as log:
+    proc = subprocess.Popen(cmd, cwd=board_dir, stdout=log, stderr=subprocess.STDOUT)
+    _, status, usage = os.wait4(proc.pid, 0)
+  wall_time = time.time() - start
+  result = {"exit_code": os.WEXITSTATUS(status) if os.WIFEXITED(status) else -1,
+            "wall_time": wall_time,
+            "cpu_time": usage.ru_utime + usage.ru_stime,
+            # ru_maxrss is in kilobytes on Linux.
+            "peak_rss": usage.ru_maxrss * 1024,
+            "stages": []}
+  if os.path.exists(profile_path):
+    with open(profile_path) as f:
+      result["stages"] = json.load(f)["stages"]
+  return result
+
+def print_table(results, out):
+  """Print the wall time of each stage for each size."""
+  stage_names = []
+  for r in results:
+    for stage in r["stages"]:
+      if stage["name"] not in stage_names:
+        stage_names.append(stage["name"])
+  columns = ["nets", "wall (s)", "rss (MB)"] + stage_names
+  widths = [max(10, len(c) + 2) for c in columns]
+  out.write("".join(c.rjust(w) for c, w in zip(columns, widths)) + "\n")
+  for r in results:
+    stages = {s["name"]: s["wall_time"] for s in r["stages"]}
+    row = ["%d" % r["nets"], "%.2f" % r["wall_time"], "%.1f" % (r["peak_rss"] / 1048576.0)]
+    row += ["%.3f" % stages[name] if name in stages else "-" for name in stage_names]
+    out.write("".join(c.rjust(w) for c, w in zip(row, widths)) + "\n")
+
+def main():
+  parser = argparse.ArgumentParser(
+      description=__doc__,
+      formatter_class=argparse.RawDescriptionHelpFormatter)
+  synthetic_board.add_board_arguments(parser)
+  parser.add_argument("--boards-dir",
+                      help="keep the boards here instead of in a temporary directory")
+  parser.add_argument("--sizes", default="10,30,100,300,1000",
+                      help="comma-separated numbers of nets")
+  parser.add_argument("--pcb2gcode", default=os.path.join(os.getcwd(), "pcb2gcode"),
+                      help="path to the pcb2gcode binary")
+  parser.add_argument("--json", help="also write all the results to this file")
+  parser.add_argument("pcb2gcode_args", nargs=argparse.REMAINDER,
+                      help="after --, more arguments for pcb2gcode")
+  args = parser.parse_args()
+  pcb2gcode_args = [a for a in args.pcb2gcode_args if a != "--"]
+  pcb2gcode = os.path.abspath(args.pcb2gcode)
+
+  base_dir = args.boards_dir or tempfile.mkdtemp()
+  results = []
+  try:
+    for size in [int(s) for s in args.sizes.split(",")]:
+      board_args = argparse.Namespace(**vars(args))
+      board_args.nets = size
+      board_args.output_dir = os.path.join(base_dir, "nets_%d" % size)
+      synthetic_board.generate(board_args)
+      print("Running %d nets... " % size, end="", file=sys.stderr)
+      sys.stderr.flush()
+      result = run(pcb2gcode, board_args.output_dir, pcb2gcode_args)
+      result["nets"] = size
+      print("%.2fs" % result["wall_time"], file=sys.stderr)
+      results.append(result)
+      if result["exit_code"] != 0:
+        print("pcb2gcode failed, see %s" % os.path.join(board_args.output_dir, "pcb2gcode.log"),
+              file=sys.stderr)
+        break
+  finally:
+    if not args.boards_dir:
+      shutil.rmtree(base_dir)
+  print_table(results, sys.stdout)
+  if args.json:
+    with open(args.json, "w") as f:
+      json.dump(results, f, indent=2)
+  return 0 if all(r["exit_code"] == 0 for r in results) else 1
+
+if __name__ == "__main__":
+  sys.exit(main())
@@ -0,0 +1,240 @@
+#!/usr/bin/python3
+
+"""Generate a synthetic board of any size for measuring pcb2gcode.
+
+The board is a grid of square cells.  Each net gets a cell with a
+round pad in one corner and a square pad in the opposite corner,
+joined by a trace on the front with a corner that is either square or
+an arc.  Vias along the trace go through to a short trace on the back.
+Some cells get SMD pads that aren't connected to anything and some get
+a filled region.  The whole board can be stepped and repeated.
+
+Writes front.gbr, back.gbr, outline.gbr, drill.drl and a millproject
+into the output directory so that running pcb2gcode there mills the
+board.
+"""
+
+from __future__ import print_function
+import argparse
+import math
+import os
+import random
+
+MILLPROJECT = """front=front.gbr
+back=back.gbr
+outline=outline.gbr
+drill=drill.drl
+
+metric=true
+metricoutput=true
+zwork=-0.05
+zsafe=2
+zchange=10
+mill-feed=600
+mill-speed=20000
+mill-diameters=0.2
+isolation-width=0.5
+drill-feed=300
+drill-speed=12000
+zdrill=-1.8
+cutter-diameter=1
+cut-feed=300
+cut-infeed=0.6
+cut-speed=12000
+zcut=-1.8
+"""
+
+def gerber_coordinate(value):
+  """Format a millimeter value for %FSLAX46Y46*%."""
+  return "%d" % round(value * 1000000)
+
+def xy(point):
+  return "X%sY%s" % (gerber_coordinate(point[0]), gerber_coordinate(point[1]))
+
+class Layer(object):
+  """The apertures and commands of one gerber layer."""
+  def __init__(self):
+    self.apertures = []
+    self.commands = []
+    self.current = None
+
+  def aperture(self, definition):
+    """Returns the D code of an aperture, adding it if needed."""
+    if definition not in self.apertures:
+      self.apertures.append(definition)
+    return "D%d" % (self.apertures.index(definition) + 10)
+
+  def select(self, definition):
+    code = self.aperture(definition)
+    if code != self.current:
+      self.commands.append(code + "*")
+      self.current = code
+
+  def flash(self, definition, point):
+    self.select(definition)
+    self.commands.append(xy(point) + "D03*")
+
+  def trace(self, width, points):
+    self.select("C,%.6f" % width)
+    self.commands.append(xy(points[0]) + "D02*")
+    for point in points[1:]:
+      self.commands.append(xy(point) + "D01*")
+
+  def arc(self, width, start, end, center):
+    """A counterclockwise arc from start to end."""
+    self.select("C,%.6f" % width)
+    self.commands.append(xy(start) + "D02*")
+    self.commands.append("G75*")
+    self.commands.append("G03%sI%sJ%sD01*" % (xy(end),
+                                               gerber_coordinate(center[0] - start[0]),
+                                               gerber_coordinate(center[1] - start[1])))
+    self.commands.append("G01*")
+
+  def region(self, points):
+    self.commands.append("G36*")
+    self.commands.append(xy(points[0]) + "D02*")
+    for point in points[1:] + points[:1]:
+      self.commands.append(xy(point) + "D01*")
+    self.commands.append("G37*")
+
+  def write(self, filename, step_repeat):
+    with open(filename, "w") as f:
+      f.write("G04 Synthetic board made by synthetic_board.py*\n")
+      f.write("%FSLAX46Y46*%\n%MOMM*%\n%LPD*%\nG01*\n")
+      for index, definition in enumerate(self.apertures):
+        f.write("%%ADD%d%s*%%\n" % (index + 10, definition))
+      if step_repeat:
+        f.write("%%SRX%dY%dI%.6fJ%.6f*%%\n" % step_repeat)
+      for command in self.commands:
+        f.write(command + "\n")
+      if step_repeat:
+        f.write("%SR*%\n")
+      f.write("M02*\n")
+
+def write_drill(filename, holes, repeats):
+  """Write an Excellon file.  holes maps diameter to a list of points."""
+  with open(filename, "w") as f:
+    f.write("M48\n;Synthetic board made by synthetic_board.py\nMETRIC,TZ\n")
+    diameters = sorted(holes)
+    for tool, diameter in enumerate(diameters, 1):
+      f.write("T%dC%.3f\n" % (tool, diameter))
+    f.write("%\nG90\nG05\n")
+    for tool, diameter in enumerate(diameters, 1):
+      f.write("T%d\n" % tool)
+      for dx, dy in repeats:
+        for x, y in holes[diameter]:
+          f.write("X%.3fY%.3f\n" % (x + dx, y + dy))
+    f.write("T0\nM30\n")
+
+def generate(args):
+  """Make the board in args.output_dir."""
+  rng = random.Random(args.seed)
+  pitch = args.pitch
+  cells = args.nets + args.regions
+  columns = max(1, int(math.ceil(math.sqrt(cells))))
+  rows = max(1, int(math.ceil(cells / float(columns))))
+  cell_kinds = ["net"] * args.nets + ["region"] * args.regions
+  rng.shuffle(cell_kinds)
+
+  front = Layer()
+  back = Layer()
+  holes = {}
+  pad = "C,%.6f" % args.pad_size
+  square_pad = "R,%.6fX%.6f" % (args.pad_size, args.pad_size)
+  via_pad = "C,%.6f" % args.via_size
+  smd_pad = "R,%.6fX%.6f" % (args.pad_size / 2, args.pad_size)
+  # Pads are this far in from the cell edges.
+  margin = 1.0
+  far = pitch - margin
+  for index, kind in enumerate(cell_kinds):
+    x0 = (index % columns) * pitch
+    y0 = (index // columns) * pitch
+    if kind == "region":
+      # A notched rectangle to make the union less trivial.
+      front.region([(x0 + margin, y0 + margin), (x0 + far, y0 + margin),
+                    (x0 + far, y0 + far), (x0 + pitch / 2, y0 + far),
+                    (x0 + pitch / 2, y0 + pitch / 2), (x0 + margin, y0 + pitch / 2)])
+      continue
+    start = (x0 + margin, y0 + margin)
+    end = (x0 + far, y0 + far)
+    front.flash(pad, start)
+    front.flash(square_pad, end)
+    holes.setdefault(args.pad_drill, []).extend([start, end])
+    corner = (x0 + far, y0 + margin)
+    if rng.random() < args.arc_fraction:
+      radius = (far - margin) / 2
+      front.trace(args.trace_width, [start, (corner[0] - radius, corner[1])])
+      front.arc(args.trace_width, (corner[0] - radius, corner[1]), (corner[0], corner[1] + radius),
+                (corner[0] - radius, corner[1] + radius))
+      front.trace(args.trace_width, [(corner[0], corner[1] + radius), end])
+    else:
+      front.trace(args.trace_width, [start, corner, end])
+    # Vias are spread along the first part of the trace and each has
+    # a trace on the back going into the cell.
+    for via in range(args.vias_per_net):
+      fraction = (via + 1.0) / (args.vias_per_net + 1) / 2
+      point = (start[0] + fraction * (far - margin), start[1])
+      front.flash(via_pad, point)
+      back.flash(via_pad, point)
+      back.trace(args.trace_width, [point, (point[0], y0 + pitch / 2)])
+      holes.setdefault(args.via_drill, []).append(point)
+    # SMD pads in a row along the top left of the cell, away from the
+    # trace.
+    for smd in range(args.smd_pads_per_net):
+      point = (x0 + margin + smd * args.pad_size, y0 + far)
+      if point[0] > x0 + pitch / 2:
+        break
+      front.flash(smd_pad, point)
+
+  width = columns * pitch
+  height = rows * pitch
+  repeat_x, repeat_y = args.step_repeat
+  step_repeat = None
+  repeats = [(0, 0)]
+  if repeat_x > 1 or repeat_y > 1:
+    step_repeat = (repeat_x, repeat_y, width, height)
+    repeats = [(i * width, j * height) for j in range(repeat_y) for i in range(repeat_x)]
+  outline = Layer()
+  outline.trace(0.1, [(0, 0), (width * repeat_x, 0), (width * repeat_x, height * repeat_y),
+                      (0, height * repeat_y), (0, 0)])
+
+  if not os.path.isdir(args.output_dir):
+    os.makedirs(args.output_dir)
+  front.write(os.path.join(args.output_dir, "front.gbr"), step_repeat)
+  back.write(os.path.join(args.output_dir, "back.gbr"), step_repeat)
+  outline.write(os.path.join(args.output_dir, "outline.gbr"), None)
+  write_drill(os.path.join(args.output_dir, "drill.drl"), holes, repeats)
+  with open(os.path.join(args.output_dir, "millproject"), "w") as f:
+    f.write(MILLPROJECT)
+
+def step_repeat_type(value):
+  x, y = value.lower().split("x")
+  return int(x), int(y)
+
+def add_board_arguments(p):
+  """Add the arguments for the board, except the output_dir and nets."""
+  p.add_argument("--vias-per-net", type=int, default=1)
+  p.add_argument("--smd-pads-per-net", type=int, default=0)
+  p.add_argument("--regions", type=int, default=0, help="number of filled regions")
+  p.add_argument("--arc-fraction", type=float, default=0.5,
+                 help="fraction of traces that turn with an arc instead of a corner")
+  p.add_argument("--trace-width", type=float, default=0.25, help="in mm")
+  p.add_argument("--pad-size", type=float, default=1.6, help="in mm")
+  p.add_argument("--pad-drill", type=float, default=0.8, help="in mm")
+  p.add_argument("--via-size", type=float, default=0.8, help="in mm")
+  p.add_argument("--via-drill", type=float, default=0.4, help="in mm")
+  p.add_argument("--pitch", type=float, default=6, help="size of each cell in mm")
+  p.add_argument("--step-repeat", type=step_repeat_type, default=(1, 1),
+                 help="repeat the copper layers, like 2x3")
+  p.add_argument("--seed", type=int, default=0)
+
+def main():
+  p = argparse.ArgumentParser(description=__doc__,
+                              formatter_class=argparse.RawDescriptionHelpFormatter)
+  p.add_argument("output_dir", help="where to write the board")
+  p.add_argument("--nets", type=int, default=100, help="number of nets")
+  add_board_arguments(p)
+  generate(p.parse_args())
+
+if __name__ == "__main__":
+  main()
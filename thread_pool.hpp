@@ -0,0 +1,167 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// A fixed number of worker threads that run submitted tasks in the
+// order that they were submitted.  A pool made with 0 or 1 threads has
+// no workers and instead runs each task immediately in the calling
+// thread, so single-threaded runs behave exactly as if there were no
+// pool at all.
+class ThreadPool {
+ public:
+  // If threads is 0, use as many threads as the hardware supports.
+  explicit ThreadPool(unsigned int threads) {
+    if (threads == 0) {
+      threads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    if (threads < 2) {
+      return;
+    }
+    workers.reserve(threads);
+    for (unsigned int i = 0; i < threads; i++) {
+      workers.emplace_back([this]() { work(); });
+    }
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    tasks_available.notify_all();
+    for (auto& worker : workers) {
+      worker.join();
+    }
+  }
+
+  // How many tasks can run at the same time.  Always at least 1.
+  size_t size() const {
+    return std::max(workers.size(), size_t(1));
+  }
+
+  // Run f on one of the workers.  The future has the result, or the
+  // exception if one was thrown.
+  template <typename F>
+  auto submit(F&& f) -> std::future<decltype(f())> {
+    using result_t = decltype(f());
+    auto task = std::make_shared<std::packaged_task<result_t()>>(std::forward<F>(f));
+    auto result = task->get_future();
+    if (workers.empty()) {
+      (*task)();
+      return result;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      tasks.emplace([task]() { (*task)(); });
+    }
+    tasks_available.notify_one();
+    return result;
+  }
+
+  // Call f(i) for each i in [0, count), with the calls spread across
+  // the workers.  Returns only after all calls are done.  The calling
+  // thread also does work so that a task that is already running on
+  // this pool can call this without deadlocking.  If any calls throw,
+  // one of the exceptions is rethrown after all the calls are done.
+  template <typename F>
+  void parallel_for(size_t count, const F& f) {
+    if (workers.empty() || count < 2) {
+      for (size_t i = 0; i < count; i++) {
+        f(i);
+      }
+      return;
+    }
+    auto state = std::make_shared<ParallelForState>();
+    state->count = count;
+    auto run = [state, &f]() {
+      {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (state->next >= state->count) {
+          return; // Nothing left to do, maybe the caller has already returned.
+        }
+        state->running++;
+      }
+      while (true) {
+        size_t i;
+        {
+          std::lock_guard<std::mutex> lock(state->mutex);
+          if (state->next >= state->count || state->error) {
+            state->next = state->count;
+            break;
+          }
+          i = state->next++;
+        }
+        try {
+          f(i);
+        } catch (...) {
+          std::lock_guard<std::mutex> lock(state->mutex);
+          state->error = std::current_exception();
+        }
+      }
+      std::lock_guard<std::mutex> lock(state->mutex);
+      state->running--;
+      state->done.notify_all();
+    };
+    const size_t helpers = std::min(workers.size(), count) - 1;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      for (size_t i = 0; i < helpers; i++) {
+        tasks.emplace(run);
+      }
+    }
+    tasks_available.notify_all();
+    run();
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->done.wait(lock, [&state]() { return state->running == 0; });
+    if (state->error) {
+      std::rethrow_exception(state->error);
+    }
+  }
+
+ private:
+  struct ParallelForState {
+    std::mutex mutex;
+    std::condition_variable done;
+    size_t next = 0;
+    size_t count = 0;
+    size_t running = 0;
+    std::exception_ptr error;
+  };
+
+  void work() {
+    while (true) {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        tasks_available.wait(lock, [this]() { return stopping || !tasks.empty(); });
+        if (tasks.empty()) {
+          return; // stopping and no more work.
+        }
+        task = std::move(tasks.front());
+        tasks.pop();
+      }
+      task();
+    }
+  }
+
+  std::vector<std::thread> workers;
+  std::queue<std::function<void()>> tasks;
+  std::mutex mutex;
+  std::condition_variable tasks_available;
+  bool stopping = false;
+};
+
+#endif // THREAD_POOL_HPP
@@ -0,0 +1,66 @@
+#define BOOST_TEST_MODULE thread pool tests
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+#include "thread_pool.hpp"
+
+BOOST_AUTO_TEST_SUITE(thread_pool_tests)
+
+BOOST_AUTO_TEST_CASE(submit) {
+  for (unsigned int threads : {1, 4}) {
+    ThreadPool pool(threads);
+    auto result = pool.submit([]() { return 42; });
+    BOOST_CHECK_EQUAL(result.get(), 42);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(submit_throws) {
+  ThreadPool pool(2);
+  auto result = pool.submit([]() -> int { throw std::runtime_error("oops"); });
+  BOOST_CHECK_THROW(result.get(), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(parallel_for) {
+  for (unsigned int threads : {0, 1, 2, 8}) {
+    ThreadPool pool(threads);
+    std::vector<size_t> results(1000);
+    pool.parallel_for(results.size(), [&](size_t i) { results[i] = i * i; });
+    for (size_t i = 0; i < results.size(); i++) {
+      BOOST_CHECK_EQUAL(results[i], i * i);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(parallel_for_throws) {
+  ThreadPool pool(4);
+  std::atomic<size_t> count(0);
+  BOOST_CHECK_THROW(pool.parallel_for(100, [&](size_t i) {
+                      count++;
+                      if (i == 10) {
+                        throw std::runtime_error("oops");
+                      }
+                    }), std::runtime_error);
+  BOOST_CHECK_LE(count, 100);
+}
+
+// A task on the pool can use the pool without deadlocking, even if
+// all the workers are busy.
+BOOST_AUTO_TEST_CASE(nested) {
+  ThreadPool pool(2);
+  std::vector<std::future<size_t>> results;
+  for (size_t i = 0; i < 4; i++) {
+    results.push_back(pool.submit([&pool]() {
+      std::atomic<size_t> total(0);
+      pool.parallel_for(100, [&](size_t j) { total += j; });
+      return total.load();
+    }));
+  }
+  for (auto& result : results) {
+    BOOST_CHECK_EQUAL(result.get(), 4950);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
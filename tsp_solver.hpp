@@ -20,14 +20,21 @@
 #ifndef TSP_HPP
 #define TSP_HPP
 
+#include <algorithm>
+#include <chrono>
+#include <deque>
 #include <vector>
 #include <list>
 #include <memory>
+#include <string>
+#include <utility>
 
 #include <boost/optional.hpp>
 
 #include "common.hpp"
 #include "geometry.hpp"
+#include "kd_tree.hpp"
+#include "profile.hpp"
 
 class tsp_solver {
  private:
@@ -63,6 +70,348 @@ class tsp_solver {
     return std::max(std::abs(p0.x() - p1.x()),
                     std::abs(p0.y() - p1.y()));
   }
+
+  // The default cost of going from one element to the next.
+  struct Chebyshev {
+    template <typename point_t>
+    double operator()(const point_t& p0, const point_t& p1) const {
+      return distance(p0, p1);
+    }
+  };
+
+  // The length of the path, starting at startingPoint if there is one.
+  template <typename point_t, typename T, typename Cost>
+  static double path_length(const std::vector<T>& path, const boost::optional<point_t>& startingPoint,
+                            const Cost& cost) {
+    double length = 0;
+    if (path.size() > 0 && startingPoint) {
+      length += cost(*startingPoint, get(path.front(), Side::FRONT));
+    }
+    for (size_t i = 0; i + 1 < path.size(); i++) {
+      length += cost(get(path[i], Side::BACK), get(path[i+1], Side::FRONT));
+    }
+    return length;
+  }
+
+  // A path being improved by local search.  The path is kept as an
+  // array of element indices with the position of each element so
+  // that any move can be evaluated in O(1), and the elements are only
+  // reversed at the end.  Only moves that make a new connection
+  // between an element and one of its neighbours are tried.  The
+  // neighbours are the elements with the endpoints nearest to its
+  // endpoints.  Each element has a "don't look" bit that is cleared
+  // only when a move changes one of its connections so elements that
+  // can't be improved are not tried again.
+  template <typename point_t, typename Cost>
+  class Tour {
+   public:
+    template <typename T>
+    Tour(const std::vector<T>& path, const boost::optional<point_t>& startingPoint,
+         size_t neighbours, const Cost& cost) :
+        n(path.size()),
+        start(startingPoint),
+        cost(cost),
+        candidates(n),
+        tour(n),
+        position(n),
+        reversed(n, false),
+        is_active(n, true) {
+      std::vector<point_t> endpoints;
+      std::vector<size_t> endpoint_element;
+      ends.reserve(n);
+      for (size_t e = 0; e < n; e++) {
+        ends.emplace_back(get(path[e], Side::FRONT), get(path[e], Side::BACK));
+        endpoints.push_back(ends[e].first);
+        endpoint_element.push_back(e);
+        if (!bg::equals(ends[e].first, ends[e].second)) {
+          endpoints.push_back(ends[e].second);
+          endpoint_element.push_back(e);
+        }
+      }
+      const KdTree<point_t> endpoint_tree(endpoints);
+      for (size_t e = 0; e < n; e++) {
+        std::vector<point_t> element_ends{ends[e].first};
+        if (!bg::equals(ends[e].first, ends[e].second)) {
+          element_ends.push_back(ends[e].second);
+        }
+        for (const auto& end : element_ends) {
+          // The element's own endpoints are also found so get more.
+          for (size_t endpoint : endpoint_tree.nearest(end, neighbours + element_ends.size())) {
+            const size_t other = endpoint_element[endpoint];
+            if (other != e &&
+                std::find(candidates[e].cbegin(), candidates[e].cend(), other) == candidates[e].cend()) {
+              candidates[e].push_back(other);
+            }
+          }
+        }
+      }
+      for (size_t i = 0; i < n; i++) {
+        tour[i] = i;
+        position[i] = i;
+        active.push_back(i);
+      }
+    }
+
+    // Returns the next element that should be tried, or none if there
+    // are no more.
+    boost::optional<size_t> next() {
+      if (active.empty()) {
+        return boost::none;
+      }
+      const size_t e = active.front();
+      active.pop_front();
+      is_active[e] = false;
+      return e;
+    }
+
+    // Try the element again later.
+    void activate_element(size_t e) {
+      activate(position[e]);
+    }
+
+    // Reverse a range that starts or ends next to e so that e gets
+    // connected to a neighbour or to the start or end of the path.
+    bool two_opt(size_t e) {
+      const size_t s = position[e];
+      if (reverse_range(0, s) || (s > 0 && reverse_range(0, s - 1)) ||
+          reverse_range(s + 1, n - 1) || reverse_range(s, n - 1)) {
+        return true;
+      }
+      for (size_t other : candidates[e]) {
+        const size_t t = position[other];
+        const size_t low = std::min(s, t);
+        const size_t high = std::max(s, t);
+        // Either connect the backs of e and other, or their fronts.
+        if (reverse_range(low + 1, high) || reverse_range(low, high - 1)) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    // Move up to 3 elements that start or end with e to just before
+    // or after one of e's neighbours, or to the start or end of the
+    // path, maybe reversing them.
+    bool or_opt(size_t e) {
+      const size_t s = position[e];
+      std::vector<size_t> targets{0, n};
+      for (size_t other : candidates[e]) {
+        targets.push_back(position[other]);
+        targets.push_back(position[other] + 1);
+      }
+      for (size_t length = 1; length <= 3; length++) {
+        for (size_t first : {s, s + 1 - length}) {
+          const size_t last = first + length - 1;
+          if (first > s || last >= n || (length == 1 && first != s)) {
+            continue;
+          }
+          // The elements will be moved to just before target.
+          for (size_t target : targets) {
+            for (bool reverse_moved : {false, true}) {
+              if ((target > last + 1 && exchange(first, last, target - 1, reverse_moved, false)) ||
+                  (target < first && exchange(target, first - 1, last, false, reverse_moved))) {
+                return true;
+              }
+            }
+          }
+        }
+      }
+      return false;
+    }
+
+    // A 3opt move that breaks the connection after e and two others,
+    // chosen so that the new connections are all to neighbours.  The
+    // two ranges between the broken connections are swapped and one
+    // of them may be reversed.  Reversing both is a 2opt move.
+    bool three_opt(size_t e) {
+      const size_t i = position[e] + 1;
+      for (size_t other : candidates[e]) {
+        const size_t t = position[other];
+        if (t <= i || t >= n) {
+          continue;
+        }
+        // Connect the back of e to the front of other, which starts
+        // the second range.  The end of the first range, which might
+        // be reversed, gets connected to whatever followed the second
+        // range.
+        for (bool reverse_first : {false, true}) {
+          const size_t first_end = tour[reverse_first ? i : t - 1];
+          for (size_t following : candidates[first_end]) {
+            if (exchange(i, t - 1, position[following] - 1, reverse_first, false)) {
+              return true;
+            }
+          }
+          if (exchange(i, t - 1, n - 1, reverse_first, false)) {
+            return true;
+          }
+        }
+        // Connect the back of e to the back of other, which ends the
+        // second range, reversed.  The start of the second range gets
+        // connected to the start of the first range.
+        for (size_t second_start : candidates[tour[i]]) {
+          const size_t j = position[second_start];
+          if (j > i && j <= t && exchange(i, j - 1, t, false, true)) {
+            return true;
+          }
+        }
+      }
+      return false;
+    }
+
+    // Put the elements of path into the order of the tour, reversing
+    // the ones that need it.
+    template <typename T>
+    void apply(std::vector<T>& path) const {
+      std::vector<T> new_path;
+      new_path.reserve(n);
+      for (size_t i = 0; i < n; i++) {
+        new_path.push_back(std::move(path[tour[i]]));
+        if (reversed[tour[i]]) {
+          reverse(new_path.back());
+        }
+      }
+      path = std::move(new_path);
+    }
+
+   private:
+    point_t front(size_t i) const {
+      return reversed[tour[i]] ? ends[tour[i]].second : ends[tour[i]].first;
+    }
+
+    point_t back(size_t i) const {
+      return reversed[tour[i]] ? ends[tour[i]].first : ends[tour[i]].second;
+    }
+
+    // Where the path is before position i and after position i, if
+    // anywhere.
+    boost::optional<point_t> before(size_t i) const {
+      return i == 0 ? start : boost::make_optional(back(i-1));
+    }
+
+    boost::optional<point_t> after(size_t i) const {
+      return i + 1 == n ? boost::none : boost::make_optional(front(i+1));
+    }
+
+    void activate(size_t i) {
+      if (i < n && !is_active[tour[i]]) {
+        is_active[tour[i]] = true;
+        active.push_back(tour[i]);
+      }
+    }
+
+    // Reverse the order and direction of positions i through j inclusive.
+    void flip(size_t i, size_t j) {
+      std::reverse(tour.begin() + i, tour.begin() + j + 1);
+      for (size_t k = i; k <= j; k++) {
+        reversed[tour[k]] = !reversed[tour[k]];
+      }
+    }
+
+    // Reverse positions i through j inclusive if it makes the path
+    // shorter, exactly like in tsp_2opt.  Returns true if it was done.
+    bool reverse_range(size_t i, size_t j) {
+      if (i > j || j >= n) {
+        return false;
+      }
+      const auto a = before(i);
+      const auto b = front(i);
+      const auto c = back(j);
+      const auto d = after(j);
+      double old_gap = (a ? cost(*a, b) : 0) +
+                       (d ? cost(c, *d) : 0);
+      double new_gap = (a ? cost(*a, c) : 0) +
+                       (d ? cost(b, *d) : 0);
+      if (!(new_gap < old_gap)) {
+        return false;
+      }
+      flip(i, j);
+      for (size_t k = i; k <= j; k++) {
+        position[tour[k]] = k;
+      }
+      activate(i - 1); // Does nothing when i is 0.
+      activate(i);
+      activate(j);
+      activate(j + 1);
+      return true;
+    }
+
+    // Swap the ranges of positions [i, j] and [j+1, k], maybe
+    // reversing either of them, if it makes the path shorter.
+    // Returns true if it was done.
+    bool exchange(size_t i, size_t j, size_t k, bool reverse_first, bool reverse_second) {
+      if (!(i <= j && j < k && k < n)) {
+        return false;
+      }
+      const auto a = before(i);
+      const auto d = after(k);
+      const auto first_front = reverse_first ? back(j) : front(i);
+      const auto first_back = reverse_first ? front(i) : back(j);
+      const auto second_front = reverse_second ? back(k) : front(j+1);
+      const auto second_back = reverse_second ? front(j+1) : back(k);
+      double old_gap = (a ? cost(*a, front(i)) : 0) +
+                       cost(back(j), front(j+1)) +
+                       (d ? cost(back(k), *d) : 0);
+      double new_gap = (a ? cost(*a, second_front) : 0) +
+                       cost(second_back, first_front) +
+                       (d ? cost(first_back, *d) : 0);
+      if (!(new_gap < old_gap)) {
+        return false;
+      }
+      std::rotate(tour.begin() + i, tour.begin() + j + 1, tour.begin() + k + 1);
+      // Where the first range starts now.
+      const size_t middle = i + (k - j);
+      if (reverse_second) {
+        flip(i, middle - 1);
+      }
+      if (reverse_first) {
+        flip(middle, k);
+      }
+      for (size_t p = i; p <= k; p++) {
+        position[tour[p]] = p;
+      }
+      activate(i - 1); // Does nothing when i is 0.
+      activate(i);
+      activate(middle - 1);
+      activate(middle);
+      activate(k);
+      activate(k + 1);
+      return true;
+    }
+
+    const size_t n;
+    const boost::optional<point_t> start;
+    const Cost cost;
+    // The front and back of each element when it isn't reversed.
+    std::vector<std::pair<point_t, point_t>> ends;
+    // The neighbours of each element.
+    std::vector<std::vector<size_t>> candidates;
+    // The element at each position.
+    std::vector<size_t> tour;
+    // The position of each element.
+    std::vector<size_t> position;
+    std::vector<bool> reversed;
+    // The elements that should be tried, in order, and whether each
+    // element is among them.
+    std::deque<size_t> active;
+    std::vector<bool> is_active;
+  };
+
+  // 2opt that uses a Tour so that only moves to neighbours are tried.
+  // Returns the number of moves made.
+  template <typename point_t, typename T, typename Cost>
+  static size_t tsp_2opt_neighbours(std::vector<T>& path, const boost::optional<point_t>& startingPoint,
+                                    size_t neighbours, const Cost& cost) {
+    Tour<point_t, Cost> tour(path, startingPoint, neighbours, cost);
+    size_t moves = 0;
+    while (auto e = tour.next()) {
+      if (tour.two_opt(*e)) {
+        moves++;
+        tour.activate_element(*e);
+      }
+    }
+    tour.apply(path);
+    return moves;
+  }
  public:
   // This function computes the optimised path of a
   //  * point_type_fp
@@ -115,11 +464,90 @@ class tsp_solver {
     }
   }
 
+  // Same as nearest_neighbour, with exactly the same result, but it
+  // uses a k-d tree to find each nearest element so it runs in O(n log
+  // n) instead of O(n^2) for typical inputs.
+  template <typename T, typename point_t>
+      static void nearest_neighbour_kd_tree(std::vector<T> &path, const point_t& startingPoint) {
+    if (path.size() == 0) {
+      return;
+    }
+    std::vector<point_t> fronts;
+    fronts.reserve(path.size());
+    for (const auto& element : path) {
+      fronts.push_back(get(element, Side::FRONT));
+    }
+    KdTree<point_t> remaining(fronts);
+
+    //Find the original path length
+    double original_length = distance(startingPoint, get(path.front(), Side::FRONT));
+    for (size_t i = 0; i + 1 < path.size(); i++) {
+      original_length += distance(get(path[i], Side::BACK), get(path[i+1], Side::FRONT));
+    }
+
+    std::vector<T> newpath;
+    newpath.reserve(path.size());
+    double new_length = 0;
+    point_t currentPoint = startingPoint;
+    while (remaining.size() > 0) {
+      const size_t nearest = remaining.nearest(currentPoint);
+      new_length += distance(currentPoint, fronts[nearest]);
+      newpath.push_back(path[nearest]);
+      currentPoint = get(path[nearest], Side::BACK);
+      remaining.remove(nearest);
+    }
+
+    if (new_length < original_length) { //If the new path is better than the previous one
+      path = newpath;
+    }
+  }
+
+  // What tsp_2opt or tsp_improve did.
+  struct Stats {
+    // How many moves were made.
+    size_t iterations = 0;
+    // The total cost of the path before and after all optimizations,
+    // including the nearest neighbour.
+    double initial_length = 0;
+    double final_length = 0;
+
+    // Add these to the profile counters of the stage, named after the
+    // algorithm.  The lengths are in millionths of the cost's unit.
+    void count(const char* stage, const std::string& algorithm) const {
+      profile::count(stage, (algorithm + " moves").c_str(), iterations);
+      profile::count(stage, (algorithm + " cost before (1e-6)").c_str(),
+                     static_cast<size_t>(initial_length * 1e6));
+      profile::count(stage, (algorithm + " cost after (1e-6)").c_str(),
+                     static_cast<size_t>(final_length * 1e6));
+    }
+  };
+
   // Same as nearest_neighbor but afterwards does 2opt optimizations.
-  template <typename point_t, typename T>
-      static void tsp_2opt(std::vector<T> &path, const boost::optional<point_t>& startingPoint) {
+  // If neighbours is 0, every pair of elements is tried until there
+  // is no more improvement, which is O(n^2) per sweep.  Otherwise
+  // only the moves that connect an element to one of the elements
+  // nearest to it are tried, which is much faster on large inputs
+  // and usually almost as good.
+  //
+  // What is minimized is the sum of cost(back, front) for each
+  // element's back and the next element's front.  The default is the
+  // Chebyshev distance.  Neighbours and the nearest neighbour path are found by
+  // Chebyshev distance so the cost should increase with it.
+  template <typename point_t, typename T, typename Cost = Chebyshev>
+      static Stats tsp_2opt(std::vector<T> &path, const boost::optional<point_t>& startingPoint,
+                            size_t neighbours = 0, const Cost& cost = Cost()) {
+    Stats stats;
+    if (path.size() == 0) {
+      return stats;
+    }
+    stats.initial_length = path_length(path, startingPoint, cost);
     // Perform greedy on path if it improves.
-    nearest_neighbour(path, startingPoint ? *startingPoint : get(path.front(), Side::FRONT));
+    nearest_neighbour_kd_tree(path, startingPoint ? *startingPoint : get(path.front(), Side::FRONT));
+    if (neighbours > 0) {
+      stats.iterations = tsp_2opt_neighbours(path, startingPoint, neighbours, cost);
+      stats.final_length = path_length(path, startingPoint, cost);
+      return stats;
+    }
     bool found_one = true;
     while (found_one) {
       found_one = false;
@@ -131,10 +559,10 @@ class tsp_solver {
                     boost::make_optional(get(path[i-1], Side::BACK)));
           auto c = get(path[j], Side::BACK);
           auto d = j + 1 == path.size() ? boost::none : boost::make_optional(get(path[j+1], Side::FRONT));
-          double old_gap = (a ? distance(*a, b) : 0) +
-                           (d ? distance(c, *d) : 0);
-          double new_gap = (a ? distance(*a, c) : 0) +
-                           (d ? distance(b, *d) : 0);
+          double old_gap = (a ? cost(*a, b) : 0) +
+                           (d ? cost(c, *d) : 0);
+          double new_gap = (a ? cost(*a, c) : 0) +
+                           (d ? cost(b, *d) : 0);
           // Should we make this 2opt swap?
           if (new_gap < old_gap) {
             // Do the 2opt swap.
@@ -145,20 +573,63 @@ class tsp_solver {
             }
             std::reverse(reverse_start, reverse_end);
             found_one = true;
+            stats.iterations++;
           }
         }
       }
     }
+    stats.final_length = path_length(path, startingPoint, cost);
+    return stats;
+  }
+
+  template <typename point_t, typename T, typename Cost = Chebyshev>
+      static Stats tsp_2opt(std::vector<T> &path, const point_t& startingPoint,
+                            size_t neighbours = 0, const Cost& cost = Cost()) {
+    return tsp_2opt(path, boost::optional<point_t>(startingPoint), neighbours, cost);
   }
 
-  template <typename point_t, typename T>
-      static void tsp_2opt(std::vector<T> &path, const point_t& startingPoint) {
-    tsp_2opt(path, boost::optional<point_t>(startingPoint));
+  template <typename point_t, typename T, typename Cost = Chebyshev>
+      static Stats tsp_2opt(std::vector<T> &path, size_t neighbours = 0, const Cost& cost = Cost()) {
+    return tsp_2opt(path, boost::optional<point_t>(), neighbours, cost);
+  }
+
+  // Improve a path, such as one from tsp_2opt, with 2opt, Or-opt and
+  // 3opt moves among each element's nearest neighbours until there
+  // are no more improvements or time_limit has passed.  Or-opt moves
+  // a few elements to somewhere else in the path and 3opt swaps two
+  // adjacent ranges of elements, and either of them may reverse
+  // elements.  Because of the time limit, the result can depend on
+  // the speed of the computer.
+  template <typename point_t, typename T, typename Cost = Chebyshev>
+      static Stats tsp_improve(std::vector<T> &path, const boost::optional<point_t>& startingPoint,
+                               std::chrono::duration<double> time_limit, size_t neighbours = 10,
+                               const Cost& cost = Cost()) {
+    const auto deadline = std::chrono::steady_clock::now() + time_limit;
+    Stats stats;
+    stats.initial_length = path_length(path, startingPoint, cost);
+    if (path.size() > 0 && time_limit.count() > 0) {
+      Tour<point_t, Cost> tour(path, startingPoint, neighbours, cost);
+      while (std::chrono::steady_clock::now() < deadline) {
+        const auto e = tour.next();
+        if (!e) {
+          break;
+        }
+        if (tour.two_opt(*e) || tour.or_opt(*e) || tour.three_opt(*e)) {
+          stats.iterations++;
+          tour.activate_element(*e);
+        }
+      }
+      tour.apply(path);
+    }
+    stats.final_length = path_length(path, startingPoint, cost);
+    return stats;
   }
 
-  template <typename point_t, typename T>
-      static void tsp_2opt(std::vector<T> &path) {
-    tsp_2opt(path, boost::optional<point_t>());
+  template <typename point_t, typename T, typename Cost = Chebyshev>
+      static Stats tsp_improve(std::vector<T> &path, const point_t& startingPoint,
+                               std::chrono::duration<double> time_limit, size_t neighbours = 10,
+                               const Cost& cost = Cost()) {
+    return tsp_improve(path, boost::optional<point_t>(startingPoint), time_limit, neighbours, cost);
   }
 };
 
@@ -1,7 +1,10 @@
 #define BOOST_TEST_MODULE tsp_solver_tests
 #include <boost/test/unit_test.hpp>
 
+#include <random>
+
 #include "tsp_solver.hpp"
+#include "bg_operators.hpp"
 
 using namespace std;
 
@@ -108,4 +111,183 @@ BOOST_AUTO_TEST_CASE(reversable_paths) {
   BOOST_CHECK_LT(nn, 10);
 }
 
+BOOST_AUTO_TEST_CASE(grid_10_by_10_neighbours) {
+  vector<point_type_fp> path;
+  for (auto i = 0; i < 10; i++) {
+    for (auto j = 0; j < 10; j++) {
+      path.push_back(point_type_fp(i, j));
+    }
+  }
+  point_type_fp start(0,0);
+  tsp_solver::nearest_neighbour(path, start);
+  double nn = get_path_length(path, start);
+  auto stats = tsp_solver::tsp_2opt(path, start, 5);
+  double tsp_2opt = get_path_length(path, start);
+  BOOST_CHECK_LT(tsp_2opt, nn);
+  BOOST_CHECK_GT(stats.iterations, 0);
+  BOOST_CHECK_LT(stats.final_length, stats.initial_length);
+  BOOST_CHECK_EQUAL(path.size(), 100);
+}
+
+BOOST_AUTO_TEST_CASE(grid_10_by_10_neighbours_no_start) {
+  vector<point_type_fp> path;
+  for (auto i = 0; i < 10; i++) {
+    for (auto j = 0; j < 10; j++) {
+      path.push_back(point_type_fp(i, j));
+    }
+  }
+  point_type_fp start(-1,-1);
+  tsp_solver::tsp_2opt(path, start, 5);
+  double tsp_2opt_with_start = get_path_length(path, start);
+  tsp_solver::tsp_2opt<point_type_fp>(path, 5);
+  double tsp_2opt_without_start = get_path_length(path);
+  BOOST_CHECK_LT(tsp_2opt_without_start, tsp_2opt_with_start);
+}
+
+BOOST_AUTO_TEST_CASE(reversable_paths_neighbours) {
+  vector<linestring_type_fp> path;
+  for (auto i = 0; i < 10; i++) {
+    path.push_back(linestring_type_fp{{static_cast<double>(i), 0},
+                                      {static_cast<double>(i), 100}});
+  }
+  point_type_fp start(0,0);
+  tsp_solver::tsp_2opt(path, start, 3);
+  double nn = get_path_length(path, start);
+  BOOST_CHECK_LT(nn, 10);
+}
+
+// Only trying the nearest neighbours should find almost as short a
+// path as trying everything, with the same elements.
+BOOST_AUTO_TEST_CASE(neighbours_random_linestrings) {
+  std::mt19937 gen(0);
+  std::uniform_real_distribution<double> coordinate(0, 100);
+  vector<linestring_type_fp> path;
+  for (auto i = 0; i < 300; i++) {
+    point_type_fp p(coordinate(gen), coordinate(gen));
+    path.push_back(linestring_type_fp{p, point_type_fp(p.x() + 1, p.y() + 2)});
+  }
+  point_type_fp start(0, 0);
+  auto all = path;
+  auto all_stats = tsp_solver::tsp_2opt(all, start);
+  auto stats = tsp_solver::tsp_2opt(path, start, 8);
+  BOOST_CHECK_LT(stats.final_length, stats.initial_length);
+  BOOST_CHECK_LT(stats.final_length, all_stats.final_length * 1.1);
+  auto normalize = [](vector<linestring_type_fp> paths) {
+    for (auto& ls : paths) {
+      if (ls.back() < ls.front()) {
+        std::reverse(ls.begin(), ls.end());
+      }
+    }
+    std::sort(paths.begin(), paths.end());
+    return paths;
+  };
+  BOOST_CHECK_EQUAL(normalize(path), normalize(all));
+}
+
+// Every move must make the path shorter so the result is never
+// longer, even when starting from a bad path.
+BOOST_AUTO_TEST_CASE(improve_random_linestrings) {
+  for (int seed = 0; seed < 20; seed++) {
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<double> coordinate(0, 100);
+    vector<linestring_type_fp> path;
+    for (auto i = 0; i < 50; i++) {
+      path.push_back(linestring_type_fp{point_type_fp(coordinate(gen), coordinate(gen)),
+                                        point_type_fp(coordinate(gen), coordinate(gen))});
+    }
+    auto original = path;
+    auto stats = tsp_solver::tsp_improve(path, point_type_fp(0, 0), std::chrono::seconds(10), 5);
+    BOOST_CHECK_GT(stats.iterations, 0);
+    BOOST_CHECK_LT(stats.final_length, stats.initial_length);
+    auto normalize = [](vector<linestring_type_fp> paths) {
+      for (auto& ls : paths) {
+        if (ls.back() < ls.front()) {
+          std::reverse(ls.begin(), ls.end());
+        }
+      }
+      std::sort(paths.begin(), paths.end());
+      return paths;
+    };
+    BOOST_CHECK_EQUAL(normalize(path), normalize(original));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(improve_after_2opt) {
+  std::mt19937 gen(1);
+  std::uniform_real_distribution<double> coordinate(0, 100);
+  vector<point_type_fp> path;
+  for (auto i = 0; i < 1000; i++) {
+    path.push_back(point_type_fp(coordinate(gen), coordinate(gen)));
+  }
+  point_type_fp start(0, 0);
+  auto stats_2opt = tsp_solver::tsp_2opt(path, start);
+  auto stats = tsp_solver::tsp_improve(path, start, std::chrono::seconds(10));
+  BOOST_CHECK_EQUAL(stats.initial_length, stats_2opt.final_length);
+  BOOST_CHECK_LT(stats.final_length, stats.initial_length);
+  BOOST_CHECK_EQUAL(path.size(), 1000);
+}
+
+BOOST_AUTO_TEST_CASE(improve_no_time) {
+  vector<point_type_fp> path{{0, 0}, {2, 2}, {1, 1}};
+  auto expected = path;
+  auto stats = tsp_solver::tsp_improve(path, point_type_fp(0, 0), std::chrono::seconds(0));
+  BOOST_CHECK_EQUAL(stats.iterations, 0);
+  BOOST_CHECK_EQUAL(path, expected);
+}
+
+// A cost that is a linear function of the distance, like the time
+// for retracting, moving and plunging, finds the same path.
+BOOST_AUTO_TEST_CASE(linear_cost) {
+  vector<point_type_fp> path;
+  std::mt19937 gen(2);
+  std::uniform_int_distribution<int> coordinate(0, 100);
+  for (auto i = 0; i < 200; i++) {
+    path.push_back(point_type_fp(coordinate(gen), coordinate(gen)));
+  }
+  point_type_fp start(0, 0);
+  auto expected = path;
+  auto expected_stats = tsp_solver::tsp_2opt(expected, start, 8);
+  auto cost = [](const point_type_fp& from, const point_type_fp& to) {
+    return 3 + 2 * std::max(std::abs(from.x() - to.x()), std::abs(from.y() - to.y()));
+  };
+  auto stats = tsp_solver::tsp_2opt(path, start, 8, cost);
+  BOOST_CHECK_EQUAL(path, expected);
+  BOOST_CHECK_EQUAL(stats.final_length, 3 * path.size() + 2 * expected_stats.final_length);
+}
+
+// The k-d tree version should make exactly the same path as the
+// regular one, even with many ties.
+BOOST_AUTO_TEST_CASE(nearest_neighbour_kd_tree_points) {
+  for (int grid : {3, 10, 1000}) {
+    std::mt19937 gen(grid);
+    std::uniform_int_distribution<int> coordinate(0, grid);
+    vector<point_type_fp> path;
+    for (auto i = 0; i < 500; i++) {
+      path.push_back(point_type_fp(coordinate(gen), coordinate(gen)));
+    }
+    auto expected = path;
+    point_type_fp start(grid/2, grid/2);
+    tsp_solver::nearest_neighbour(expected, start);
+    tsp_solver::nearest_neighbour_kd_tree(path, start);
+    BOOST_CHECK_EQUAL(path, expected);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(nearest_neighbour_kd_tree_linestrings) {
+  for (int grid : {3, 10, 1000}) {
+    std::mt19937 gen(grid);
+    std::uniform_int_distribution<int> coordinate(0, grid);
+    vector<linestring_type_fp> path;
+    for (auto i = 0; i < 500; i++) {
+      path.push_back(linestring_type_fp{point_type_fp(coordinate(gen), coordinate(gen)),
+                                        point_type_fp(coordinate(gen), coordinate(gen))});
+    }
+    auto expected = path;
+    point_type_fp start(0, 0);
+    tsp_solver::nearest_neighbour(expected, start);
+    tsp_solver::nearest_neighbour_kd_tree(path, start);
+    BOOST_CHECK_EQUAL(path, expected);
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -21,21 +21,31 @@
 
 #include "voronoi.hpp"
 #include "voronoi_visual_utils.hpp"
+#include "profile.hpp"
 #include <list>
 #include <map>
 #include <algorithm>
+#include <cmath>
+#include <limits>
 using std::list;
 using std::map;
 
 #include <vector>
 using std::vector;
 
+#include <utility>
+using std::pair;
+
 // For use when we have to convert from float to long and back.
 const double SCALE = 1000000.0;
 
 multi_polygon_type_fp Voronoi::build_voronoi(
     const multi_polygon_type_fp& input,
-    const box_type_fp& mask_bounding_box, coordinate_type_fp max_dist) {
+    const box_type_fp& mask_bounding_box, coordinate_type_fp max_dist,
+    unsigned int tiles, const std::shared_ptr<ThreadPool>& thread_pool,
+    coordinate_type_fp reach) {
+  profile::Timer timer("build_voronoi");
+  profile::count("build_voronoi", "polygons", input.size());
   // We need to scale all the inputs and call the integer version.
   multi_polygon_type_fp scaled_input;
   bg::transform(input, scaled_input,
@@ -52,7 +62,10 @@ multi_polygon_type_fp Voronoi::build_voronoi(
   box_type voronoi_bounding_box;
   bg::convert(scaled_mask_bounding_box, voronoi_bounding_box);
 
-  const multi_polygon_type_fp scaled_voronoi = build_voronoi(voronoi_input, voronoi_bounding_box, max_dist * SCALE);
+  const multi_polygon_type_fp scaled_voronoi =
+      tiles > 1 ?
+      build_voronoi_tiled(voronoi_input, voronoi_bounding_box, max_dist * SCALE, tiles, thread_pool, reach * SCALE) :
+      build_voronoi(voronoi_input, voronoi_bounding_box, max_dist * SCALE);
   // Scale the result back down.
   multi_polygon_type_fp voronoi;
   bg::transform(scaled_voronoi, voronoi,
@@ -67,23 +80,16 @@ multi_polygon_type_fp Voronoi::build_voronoi(
     if (input.empty()) {
         return multi_polygon_type_fp();
     }
+    Diagram diagram(input, mask_bounding_box);
+    return diagram_to_polygons(diagram, input.size(), max_dist);
+}
 
+Voronoi::Diagram::Diagram(const multi_polygon_type& input, const box_type& mask_bounding_box) {
     // Bounding_box is a box that is big enough to hold all milling.
-    box_type_fp bounding_box = bg::return_envelope<box_type_fp>(input);
+    box_type_fp input_bounding_box = bg::return_envelope<box_type_fp>(input);
     // Expand that bounding box by the provided bounding_box.
-    bg::expand(bounding_box, mask_bounding_box);
-    // Make it large enough so that any voronoi edges between it and
-    // the input will surely line outside mask_bounding_box.
-    const auto bounding_box_width = bounding_box.max_corner().x() - bounding_box.min_corner().x();
-    const auto bounding_box_height = bounding_box.max_corner().y() - bounding_box.min_corner().y();
-    bounding_box.max_corner().x(bounding_box.max_corner().x() + 2*bounding_box_width);
-    bounding_box.min_corner().x(bounding_box.min_corner().x() - 2*bounding_box_width);
-    bounding_box.max_corner().y(bounding_box.max_corner().y() + 2*bounding_box_height);
-    bounding_box.min_corner().y(bounding_box.min_corner().y() - 2*bounding_box_height);
-    // Each line segment from all the inputs.
-    vector<segment_type_p> segments;
-    // From which polygon each segment is sourced.
-    std::vector<size_t> segments_to_poly;
+    bg::expand(input_bounding_box, mask_bounding_box);
+    bounding_box = outer_bounding_box(input_bounding_box);
     for (const auto& polygon : input) {
         copy_ring(polygon.outer(), segments);
         for (const ring_type& ring : polygon.inners()) {
@@ -100,15 +106,30 @@ multi_polygon_type_fp Voronoi::build_voronoi(
 
     voronoi_builder_type voronoi_builder;
     boost::polygon::insert(segments.begin(), segments.end(), &voronoi_builder);
-    voronoi_diagram_type voronoi_diagram;
     voronoi_builder.construct(&voronoi_diagram);
+}
+
+box_type_fp Voronoi::Diagram::outer_bounding_box(const box_type_fp& box) {
+    // Make it large enough so that any voronoi edges between it and
+    // the input will surely line outside the box.
+    const auto width = box.max_corner().x() - box.min_corner().x();
+    const auto height = box.max_corner().y() - box.min_corner().y();
+    return box_type_fp(point_type_fp(box.min_corner().x() - 2*width, box.min_corner().y() - 2*height),
+                       point_type_fp(box.max_corner().x() + 2*width, box.max_corner().y() + 2*height));
+}
+
+multi_polygon_type_fp Voronoi::diagram_to_polygons(const Diagram& diagram, size_t input_size, coordinate_type max_dist) {
+    const auto& segments = diagram.segments;
+    const auto& segments_to_poly = diagram.segments_to_poly;
+    const auto& bounding_box = diagram.bounding_box;
+    const auto& voronoi_diagram = diagram.voronoi_diagram;
 
     // The output polygons which are voronoi shapes.  The outputs
     // match the inputs in number and position but the number of inner
     // rings for each output polygon might not match.
     multi_polygon_type_fp output;
     // Pre-allocate because we are going to add elements out of order.
-    output.resize(input.size());
+    output.resize(input_size);
 
     // To keep it simply, we first mark each edge as used if it won't
     // be part of the output.
@@ -168,6 +189,234 @@ multi_polygon_type_fp Voronoi::build_voronoi(
     return output;
 }
 
+// The distance from p to the closest point of the segment.
+static coordinate_type_fp distance_to_segment(const point_type_fp& p, const segment_type_p& segment) {
+  const coordinate_type_fp x0 = low(segment).x();
+  const coordinate_type_fp y0 = low(segment).y();
+  const coordinate_type_fp dx = high(segment).x() - x0;
+  const coordinate_type_fp dy = high(segment).y() - y0;
+  const coordinate_type_fp length_squared = dx*dx + dy*dy;
+  coordinate_type_fp t = 0;
+  if (length_squared > 0) {
+    t = std::min(std::max(((p.x() - x0)*dx + (p.y() - y0)*dy) / length_squared, 0.0), 1.0);
+  }
+  return std::hypot(p.x() - (x0 + t*dx), p.y() - (y0 + t*dy));
+}
+
+coordinate_type_fp Voronoi::distance_to_site(const point_type_fp& p, const cell_type& cell,
+                                             const vector<segment_type_p>& segments) {
+  if (cell.contains_point()) {
+    const point_type_p site = retrieve_point(cell, segments);
+    return std::hypot(p.x() - site.x(), p.y() - site.y());
+  }
+  return distance_to_segment(p, retrieve_segment(cell, segments));
+}
+
+coordinate_type_fp Voronoi::max_distance_to_sites(const Diagram& diagram, const box_type_fp& region,
+                                                  coordinate_type max_dist) {
+  coordinate_type_fp result = 0;
+  // Along a voronoi edge, the distance to the sites on either side
+  // decreases and then increases so the farthest point on each part
+  // of an edge that is in the region is one of the ends of that part.
+  for (const edge_type& edge : diagram.voronoi_diagram.edges()) {
+    if (edge.twin() < &edge) {
+      continue; // The twin is the same edge.
+    }
+    const linestring_type_fp ls = edge_to_linestring(edge, diagram.segments, diagram.bounding_box, max_dist);
+    if (ls.size() < 2) {
+      continue;
+    }
+    const auto envelope = bg::return_envelope<box_type_fp>(ls);
+    if (bg::disjoint(envelope, region)) {
+      continue;
+    }
+    multi_linestring_type_fp parts;
+    if (bg::covered_by(envelope, region)) {
+      parts.push_back(ls);
+    } else {
+      bg::intersection(ls, region, parts);
+    }
+    for (const auto& part : parts) {
+      result = std::max({result,
+                         distance_to_site(part.front(), *edge.cell(), diagram.segments),
+                         distance_to_site(part.back(), *edge.cell(), diagram.segments)});
+    }
+  }
+  // Inside a cell the distance to its site is convex so the farthest
+  // point along each side of the region is where it crosses an edge,
+  // which is done above, or at a corner.
+  const auto& min_corner = region.min_corner();
+  const auto& max_corner = region.max_corner();
+  for (const auto& corner : {min_corner, max_corner,
+                             point_type_fp(min_corner.x(), max_corner.y()),
+                             point_type_fp(max_corner.x(), min_corner.y())}) {
+    coordinate_type_fp nearest = std::numeric_limits<coordinate_type_fp>::infinity();
+    for (const auto& segment : diagram.segments) {
+      nearest = std::min(nearest, distance_to_segment(corner, segment));
+    }
+    result = std::max(result, nearest);
+  }
+  // The curved edges are only accurate to within max_dist.
+  return result + max_dist;
+}
+
+multi_polygon_type_fp Voronoi::build_voronoi_tiled(
+    const multi_polygon_type& input,
+    const box_type& mask_bounding_box, coordinate_type max_dist,
+    unsigned int tiles, const std::shared_ptr<ThreadPool>& thread_pool,
+    coordinate_type_fp reach) {
+  if (input.size() < 2) {
+    return build_voronoi(input, mask_bounding_box, max_dist);
+  }
+  // Every tile uses the same bounding box so that the sites around
+  // the outside are the same in all of them.
+  box_type all_bounding_box = bg::return_envelope<box_type>(input);
+  bg::expand(all_bounding_box, mask_bounding_box);
+  vector<box_type_fp> envelopes;
+  envelopes.reserve(input.size());
+  for (const auto& polygon : input) {
+    envelopes.push_back(bg::return_envelope<box_type_fp>(polygon));
+  }
+  const coordinate_type_fp min_x = all_bounding_box.min_corner().x();
+  const coordinate_type_fp min_y = all_bounding_box.min_corner().y();
+  const coordinate_type_fp tile_width = (all_bounding_box.max_corner().x() - min_x) / tiles;
+  const coordinate_type_fp tile_height = (all_bounding_box.max_corner().y() - min_y) / tiles;
+  // The outer tiles reach out to the ring around the outside of every
+  // diagram, which is the same as without tiles, so that the regions
+  // outside the bounding box aren't clipped.
+  box_type_fp all_bounding_box_fp;
+  bg::convert(all_bounding_box, all_bounding_box_fp);
+  const box_type_fp outer = Diagram::outer_bounding_box(all_bounding_box_fp);
+  // The regions only need to be right within reach of the bounding
+  // box.  Checking the rest of the outer tiles would need almost every
+  // polygon.
+  const box_type_fp exact(
+      point_type_fp(all_bounding_box_fp.min_corner().x() - reach, all_bounding_box_fp.min_corner().y() - reach),
+      point_type_fp(all_bounding_box_fp.max_corner().x() + reach, all_bounding_box_fp.max_corner().y() + reach));
+  const auto tile_edge = [&](int index, coordinate_type_fp start, coordinate_type_fp size,
+                             coordinate_type_fp outer_min, coordinate_type_fp outer_max) {
+    if (index <= 0) {
+      return outer_min;
+    }
+    if (index >= int(tiles)) {
+      return outer_max;
+    }
+    return start + index * size;
+  };
+
+  // For each tile, the polygon indices and the parts of their regions
+  // that are in the tile.
+  vector<vector<pair<size_t, multi_polygon_type_fp>>> tile_regions(tiles * tiles);
+  const auto build_tile = [&](size_t tile_index) {
+    const int column = tile_index % tiles;
+    const int row = tile_index / tiles;
+    const box_type_fp tile(
+        point_type_fp(tile_edge(column, min_x, tile_width, outer.min_corner().x(), outer.max_corner().x()),
+                      tile_edge(row, min_y, tile_height, outer.min_corner().y(), outer.max_corner().y())),
+        point_type_fp(tile_edge(column + 1, min_x, tile_width, outer.min_corner().x(), outer.max_corner().x()),
+                      tile_edge(row + 1, min_y, tile_height, outer.min_corner().y(), outer.max_corner().y())));
+    // Only the polygons near the tile are used.  The regions in the
+    // tile are right if every point in the part of the tile that is
+    // checked has its nearest polygon within the margin, otherwise try
+    // again with more.  The nearest polygon is never farther than the
+    // nearest one in this diagram so a margin of that distance is
+    // enough and it's safe to start small.
+    const box_type_fp checked(
+        point_type_fp(std::max(tile.min_corner().x(), exact.min_corner().x()),
+                      std::max(tile.min_corner().y(), exact.min_corner().y())),
+        point_type_fp(std::min(tile.max_corner().x(), exact.max_corner().x()),
+                      std::min(tile.max_corner().y(), exact.max_corner().y())));
+    const bool check = checked.min_corner().x() < checked.max_corner().x() &&
+                       checked.min_corner().y() < checked.max_corner().y();
+    coordinate_type_fp margin = std::max(tile_width, tile_height) / 8;
+    while (true) {
+      const box_type_fp reach(
+          point_type_fp(tile.min_corner().x() - margin, tile.min_corner().y() - margin),
+          point_type_fp(tile.max_corner().x() + margin, tile.max_corner().y() + margin));
+      vector<size_t> indices;
+      multi_polygon_type nearby;
+      for (size_t i = 0; i < input.size(); i++) {
+        if (!bg::disjoint(envelopes[i], reach)) {
+          indices.push_back(i);
+          nearby.push_back(input[i]);
+        }
+      }
+      if (indices.empty()) {
+        margin *= 2;
+        continue;
+      }
+      const Diagram diagram(nearby, all_bounding_box);
+      profile::count("build_voronoi", "tile polygons", nearby.size());
+      if (indices.size() < input.size() && check) {
+        const coordinate_type_fp distance = max_distance_to_sites(diagram, checked, max_dist);
+        if (distance > margin) {
+          margin = std::max(distance, margin * 2);
+          continue;
+        }
+      }
+      const multi_polygon_type_fp regions = diagram_to_polygons(diagram, nearby.size(), max_dist);
+      for (size_t i = 0; i < indices.size(); i++) {
+        multi_polygon_type_fp region_in_tile;
+        bg::intersection(regions[i], tile, region_in_tile);
+        if (!region_in_tile.empty()) {
+          tile_regions[tile_index].push_back(std::make_pair(indices[i], region_in_tile));
+        }
+      }
+      return;
+    }
+  };
+
+  // Put together the parts of each region.
+  vector<vector<const multi_polygon_type_fp*>> parts(input.size());
+  multi_polygon_type_fp output;
+  output.resize(input.size());
+  const auto join_parts = [&](size_t i) {
+    multi_polygon_type_fp joined;
+    for (const auto* part : parts[i]) {
+      multi_polygon_type_fp temp;
+      bg::union_(joined, *part, temp);
+      joined.swap(temp);
+    }
+    // Within reach, the parts of a region always meet but a tiny gap
+    // along a tile edge could split it.  Farther out, a tile might
+    // have a part of the region that doesn't meet the rest.  So keep
+    // the piece with the input polygon in it or else the largest.
+    coordinate_type_fp largest_area = 0;
+    for (auto& polygon : joined) {
+      if (!input[i].outer().empty() &&
+          bg::covered_by(point_type_fp(input[i].outer().front().x(), input[i].outer().front().y()), polygon)) {
+        output[i] = std::move(polygon);
+        return;
+      }
+      const auto area = bg::area(polygon);
+      if (area > largest_area) {
+        largest_area = area;
+        output[i] = std::move(polygon);
+      }
+    }
+  };
+  if (thread_pool) {
+    thread_pool->parallel_for(tile_regions.size(), build_tile);
+  } else {
+    for (size_t tile_index = 0; tile_index < tile_regions.size(); tile_index++) {
+      build_tile(tile_index);
+    }
+  }
+  for (const auto& regions : tile_regions) {
+    for (const auto& index_and_region : regions) {
+      parts[index_and_region.first].push_back(&index_and_region.second);
+    }
+  }
+  if (thread_pool) {
+    thread_pool->parallel_for(input.size(), join_parts);
+  } else {
+    for (size_t i = 0; i < input.size(); i++) {
+      join_parts(i);
+    }
+  }
+  return output;
+}
+
 bool Voronoi::same_poly(const edge_type& edge0, const edge_type& edge1, const std::vector<size_t>& segments_to_poly) {
     return (std::upper_bound(segments_to_poly.cbegin(), segments_to_poly.cend(), edge0.cell()->source_index()) ==
             std::upper_bound(segments_to_poly.cbegin(), segments_to_poly.cend(), edge1.cell()->source_index()));
@@ -24,9 +24,11 @@
 
 #include <vector>
 #include <memory>
+#include <limits>
 
 #include "geometry.hpp"
 #include "geometry_int.hpp"
+#include "thread_pool.hpp"
 
 namespace boost { namespace polygon { namespace detail {
 
@@ -70,15 +72,55 @@ public:
      * each output might not match those of the corresponding input.  max_dist
      * is the maximum error for interpolating parabolic curves into discrete
      * linestrings.  Smaller means more accurate and more points.
+     *
+     * With more than 1 tile, the board is split into tiles x tiles
+     * parts that are computed separately, on the thread_pool if there
+     * is one, and then joined.  Each part only uses the polygons near
+     * it.  The outer tiles reach out to the ring around the outside
+     * of the diagram so nothing is clipped off.  Within reach of the
+     * bounding_box, the regions match those made without tiles except
+     * that where a curved edge crosses from one tile to another the
+     * two sides might differ by up to max_dist.  Farther out, each
+     * tile's regions are those of just the polygons near it, so they
+     * might not be the nearest and might not cover everything.
      */
   static multi_polygon_type_fp build_voronoi(
       const multi_polygon_type& input,
       const box_type& bounding_box, coordinate_type max_dist);
   static multi_polygon_type_fp build_voronoi(
       const multi_polygon_type_fp& input,
-      const box_type_fp& bounding_box, coordinate_type_fp max_dist);
+      const box_type_fp& bounding_box, coordinate_type_fp max_dist,
+      unsigned int tiles = 1, const std::shared_ptr<ThreadPool>& thread_pool = nullptr,
+      coordinate_type_fp reach = std::numeric_limits<coordinate_type_fp>::infinity());
 
 protected:
+    // The diagram of all the segments of the input, with a ring
+    // around the outside far enough away that it doesn't affect the
+    // regions near the input.
+    struct Diagram {
+      Diagram(const multi_polygon_type& input, const box_type& mask_bounding_box);
+      // Where the ring around the outside goes for input and masks
+      // that fit in box.
+      static box_type_fp outer_bounding_box(const box_type_fp& box);
+      box_type_fp bounding_box;
+      // Each line segment from all the inputs, followed by the ring
+      // around the outside.
+      std::vector<segment_type_p> segments;
+      // For each input polygon, the index after its last segment.
+      std::vector<size_t> segments_to_poly;
+      voronoi_diagram_type voronoi_diagram;
+    };
+    static multi_polygon_type_fp diagram_to_polygons(const Diagram& diagram, size_t input_size, coordinate_type max_dist);
+    static multi_polygon_type_fp build_voronoi_tiled(
+        const multi_polygon_type& input,
+        const box_type& mask_bounding_box, coordinate_type max_dist,
+        unsigned int tiles, const std::shared_ptr<ThreadPool>& thread_pool,
+        coordinate_type_fp reach);
+    // The farthest that any point in region is from its nearest site.
+    static coordinate_type_fp max_distance_to_sites(const Diagram& diagram, const box_type_fp& region,
+                                                    coordinate_type max_dist);
+    static coordinate_type_fp distance_to_site(const point_type_fp& p, const cell_type& cell,
+                                               const std::vector<segment_type_p>& segments);
     static linestring_type_fp edge_to_linestring(const edge_type& edge, const std::vector<segment_type_p>& segments, const box_type_fp& bounding_box, coordinate_type max_dist);
     static void copy_ring(const ring_type& ring, std::vector<segment_type_p> &segments);
     static point_type_p retrieve_point(const cell_type& cell, const std::vector<segment_type_p> &segments);
@@ -4,6 +4,7 @@
 #include <boost/format.hpp>
 #include <fstream>
 #include "voronoi.hpp"
+#include "profile.hpp"
 
 using namespace std;
 
@@ -90,4 +91,100 @@ BOOST_AUTO_TEST_CASE(almost_square_with_hole) {
   BOOST_CHECK(result[1].inners().size() == 0);
 }
 
+// Squares and diamonds in a grid, offset a little so that the
+// regions have curved edges.
+multi_polygon_type_fp tiles_input() {
+  multi_polygon_type_fp mp;
+  for (int x = 0; x < 8; x++) {
+    for (int y = 0; y < 6; y++) {
+      const double cx = x + 0.1 * ((x * 7 + y * 3) % 5);
+      const double cy = y + 0.1 * ((x * 2 + y * 5) % 3);
+      polygon_type_fp poly;
+      if ((x + y) % 2) {
+        bg::read_wkt((boost::format("POLYGON((%1% %2%, %1% %4%, %3% %4%, %3% %2%, %1% %2%))")
+                      % (cx - 0.2) % (cy - 0.2) % (cx + 0.2) % (cy + 0.2)).str(), poly);
+      } else {
+        bg::read_wkt((boost::format("POLYGON((%1% %2%, %3% %4%, %1% %5%, %6% %4%, %1% %2%))")
+                      % cx % (cy - 0.3) % (cx - 0.3) % cy % (cy + 0.3) % (cx + 0.3)).str(), poly);
+      }
+      bg::correct(poly);
+      mp.push_back(poly);
+    }
+  }
+  return mp;
+}
+
+BOOST_AUTO_TEST_CASE(tiles) {
+  const multi_polygon_type_fp mp = tiles_input();
+  const box_type_fp bounding_box = bg::return_envelope<box_type_fp>(mp);
+  const auto expected = Voronoi::build_voronoi(mp, bounding_box, 0.001);
+  const auto result = Voronoi::build_voronoi(mp, bounding_box, 0.001, 3, std::make_shared<ThreadPool>(2));
+  BOOST_REQUIRE_EQUAL(result.size(), mp.size());
+  // The whole regions are compared, including outside the bounding
+  // box where the outer tiles reach.
+  double difference = 0;
+  double outside_area = 0;
+  for (size_t i = 0; i < mp.size(); i++) {
+    multi_polygon_type_fp temp;
+    bg::sym_difference(expected[i], result[i], temp);
+    difference += bg::area(temp);
+    multi_polygon_type_fp outside;
+    bg::difference(result[i], bounding_box, outside);
+    outside_area += bg::area(outside);
+  }
+  BOOST_CHECK_LT(difference, bg::area(bounding_box) * 1e-4);
+  BOOST_CHECK_GT(outside_area, bg::area(bounding_box));
+}
+
+// The number of polygons in the diagrams of all the tiles.
+size_t tile_polygons() {
+  for (const auto& stage : profile::stages()) {
+    for (const auto& counter : stage.counters) {
+      if (stage.name == "build_voronoi" && counter.first == "tile polygons") {
+        return counter.second;
+      }
+    }
+  }
+  return 0;
+}
+
+// With a reach, the regions only have to match within reach of the
+// bounding box.
+BOOST_AUTO_TEST_CASE(tiles_with_reach) {
+  const multi_polygon_type_fp mp = tiles_input();
+  const box_type_fp bounding_box = bg::return_envelope<box_type_fp>(mp);
+  const double reach = 0.5;
+  const auto expected = Voronoi::build_voronoi(mp, bounding_box, 0.001);
+  // Only the part of each tile within reach is checked, so the outer
+  // tiles need fewer polygons than without a reach.
+  profile::enable(true);
+  profile::reset();
+  Voronoi::build_voronoi(mp, bounding_box, 0.001, 3);
+  const size_t polygons_without_reach = tile_polygons();
+  profile::reset();
+  const auto result = Voronoi::build_voronoi(mp, bounding_box, 0.001, 3, nullptr, reach);
+  const size_t polygons_with_reach = tile_polygons();
+  profile::enable(false);
+  BOOST_CHECK_LT(polygons_with_reach, polygons_without_reach);
+  BOOST_REQUIRE_EQUAL(result.size(), mp.size());
+  box_type_fp exact;
+  bg::buffer(bounding_box, exact, reach);
+  // bg::sym_difference sometimes fails on regions that are nearly the
+  // same so the difference is the union less the intersection.
+  double difference = 0;
+  for (size_t i = 0; i < mp.size(); i++) {
+    BOOST_CHECK(bg::covered_by(mp[i], result[i]));
+    multi_polygon_type_fp expected_in_exact;
+    bg::intersection(expected[i], exact, expected_in_exact);
+    multi_polygon_type_fp result_in_exact;
+    bg::intersection(result[i], exact, result_in_exact);
+    multi_polygon_type_fp both;
+    bg::intersection(expected_in_exact, result_in_exact, both);
+    multi_polygon_type_fp either;
+    bg::union_(expected_in_exact, result_in_exact, either);
+    difference += bg::area(either) - bg::area(both);
+  }
+  BOOST_CHECK_LT(difference, bg::area(bounding_box) * 1e-4);
+}
+
 BOOST_AUTO_TEST_SUITE_END()